@@ -0,0 +1,459 @@
+#pragma once
+
+#include "article_tags.hpp"
+#include "articles_dto.hpp"
+#include "common.hpp"
+#include "entity.hpp"
+#include "page_cursor.hpp"
+#include "site_feeds.hpp"
+#include "site_stats.hpp"
+#include "tag_catalog.hpp"
+#include "view_counter.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace purecpp {
+
+// 已发布文章的一行数据(列表字段 + 文章ID)
+struct feed_row {
+  uint64_t article_id;
+  std::string title;
+  std::string summary;
+  std::string slug;
+  std::string author_name;
+  uint64_t author_id;
+  std::string tag_ids;
+  uint64_t created_at;
+  uint64_t updated_at;
+  uint32_t views_count;
+  uint32_t comments_count;
+  int featured_weight;
+};
+
+// 排序键：置顶权重降序，创建时间降序，文章ID降序
+struct feed_key {
+  int featured_weight;
+  uint64_t created_at;
+  uint64_t article_id;
+
+  bool operator<(const feed_key &other) const {
+    if (featured_weight != other.featured_weight) {
+      return featured_weight > other.featured_weight;
+    }
+    if (created_at != other.created_at) {
+      return created_at > other.created_at;
+    }
+    return article_id > other.article_id;
+  }
+
+  bool operator==(const feed_key &other) const = default;
+};
+
+struct feed_entry {
+  feed_key key;
+  std::vector<int> tags; // 已排序的标签ID
+  article_list summary;
+};
+
+struct feed_page {
+  std::vector<article_list> list;
+  size_t total_count = 0;
+  std::optional<feed_key> next; // 还有下一页时为本页最后一篇文章的排序键
+};
+
+// 游标和排序键互相转换
+inline feed_key to_feed_key(const page_cursor &cursor) {
+  return feed_key{cursor.featured_weight, cursor.created_at, cursor.id};
+}
+
+inline std::optional<std::string> next_cursor_of(const feed_page &page) {
+  if (!page.next) {
+    return std::nullopt;
+  }
+  return encode_cursor(page_cursor{page.next->featured_weight,
+                                   page.next->created_at,
+                                   page.next->article_id});
+}
+
+/**
+ * @brief 已发布文章的内存列表
+ *
+ * 启动时从数据库加载所有已发布且未删除的文章摘要，按标签组和标签
+ * 维护按排序键预排序的列表，
+ * 文章状态变化时(审核、编辑、删除、加精华)通过refresh增量更新，
+ * 列表页和总数直接从内存获取，不再访问数据库。
+ */
+class article_feed {
+public:
+  static article_feed &instance() {
+    static article_feed instance;
+    return instance;
+  }
+
+  /**
+   * @brief 从数据库加载已发布文章，标签分组取自tag_catalog，
+   * 标签分组变化时重新分组
+   */
+  bool init() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "article feed init failed: no db connection";
+      return false;
+    }
+
+    auto rows = conn->select(col(&articles_t::article_id),
+                             col(&articles_t::title),
+                             col(&articles_t::abstraction),
+                             col(&articles_t::slug), col(&users_t::user_name),
+                             col(&articles_t::author_id),
+                             col(&articles_t::tag_ids),
+                             col(&articles_t::created_at),
+                             col(&articles_t::updated_at),
+                             col(&articles_t::views_count),
+                             col(&articles_t::comments_count),
+                             col(&articles_t::featured_weight))
+                    .from<articles_t>()
+                    .inner_join(col(&articles_t::author_id), col(&users_t::id))
+                    .where(col(&articles_t::is_deleted) == 0 &&
+                           col(&articles_t::status) == PUBLISHED.data())
+                    .collect<feed_row>();
+
+    std::unique_lock lock(mutex_);
+    tags_ = tag_catalog::instance().snapshot();
+
+    entries_.clear();
+    slugs_.clear();
+    groups_.clear();
+    tag_keys_.clear();
+    for (auto &row : rows) {
+      insert_locked(std::move(row));
+    }
+    CINATRA_LOG_INFO << "article feed loaded " << entries_.size()
+                     << " published articles";
+
+    std::vector<article_list> published;
+    published.reserve(entries_.size());
+    for (const auto &[article_id, entry] : entries_) {
+      published.push_back(entry.summary);
+    }
+    lock.unlock();
+    site_feeds::instance().rebuild(published);
+
+    tag_catalog::instance().on_groups_changed(
+        [this](const tag_catalog::snapshot_ptr &tags) { regroup(tags); });
+    return true;
+  }
+
+  /**
+   * @brief 按新的标签分组重建各标签组的文章列表
+   */
+  void regroup(tag_catalog::snapshot_ptr tags) {
+    std::unique_lock lock(mutex_);
+    tags_ = std::move(tags);
+    groups_.clear();
+    for (const auto &[article_id, entry] : entries_) {
+      for (int group : groups_of(entry.tags)) {
+        groups_[group].push_back(entry.key);
+      }
+    }
+    for (auto &[group, keys] : groups_) {
+      std::sort(keys.begin(), keys.end());
+    }
+  }
+
+  /**
+   * @brief 重新加载单篇文章：已发布则插入或更新，否则从列表中移除
+   * @param slug 文章slug
+   */
+  void refresh(std::string_view slug) {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "article feed refresh failed: no db connection";
+      return;
+    }
+
+    auto rows = conn->select(col(&articles_t::article_id),
+                             col(&articles_t::title),
+                             col(&articles_t::abstraction),
+                             col(&articles_t::slug), col(&users_t::user_name),
+                             col(&articles_t::author_id),
+                             col(&articles_t::tag_ids),
+                             col(&articles_t::created_at),
+                             col(&articles_t::updated_at),
+                             col(&articles_t::views_count),
+                             col(&articles_t::comments_count),
+                             col(&articles_t::featured_weight))
+                    .from<articles_t>()
+                    .inner_join(col(&articles_t::author_id), col(&users_t::id))
+                    .where(col(&articles_t::slug).param() &&
+                           col(&articles_t::is_deleted) == 0 &&
+                           col(&articles_t::status) == PUBLISHED.data())
+                    .collect<feed_row>(std::string(slug));
+
+    if (!rows.empty()) {
+      // 加上还没写回数据库的浏览量
+      rows.front().views_count += view_counter::instance().pending(slug);
+    }
+
+    std::unique_lock lock(mutex_);
+    int64_t delta = erase_locked(slug) ? -1 : 0;
+    std::optional<article_list> published;
+    if (!rows.empty()) {
+      uint64_t article_id = rows.front().article_id;
+      insert_locked(std::move(rows.front()));
+      published = entries_.at(article_id).summary;
+      delta++;
+    }
+    // 文章发布或下线时更新站点统计
+    site_stats::instance().add_articles(delta);
+    lock.unlock();
+
+    if (published) {
+      site_feeds::instance().upsert(*published);
+    } else {
+      site_feeds::instance().remove(slug);
+    }
+  }
+
+  /**
+   * @brief 增加文章浏览量(仅内存)
+   */
+  void add_views(std::string_view slug, uint32_t n) {
+    std::unique_lock lock(mutex_);
+    auto it = slugs_.find(std::string(slug));
+    if (it == slugs_.end()) {
+      return;
+    }
+    entries_[it->second].summary.views_count += n;
+  }
+
+  /**
+   * @brief 批量获取文章摘要，不在已发布列表中的文章ID对应std::nullopt
+   */
+  std::vector<std::optional<article_list>>
+  find_all(const std::vector<uint64_t> &ids) {
+    std::vector<std::optional<article_list>> list(ids.size());
+    std::shared_lock lock(mutex_);
+    for (size_t i = 0; i < ids.size(); i++) {
+      auto it = entries_.find(ids[i]);
+      if (it != entries_.end()) {
+        list[i] = it->second.summary;
+      }
+    }
+    return list;
+  }
+
+  /**
+   * @brief 按给定顺序获取文章摘要，不在已发布列表中的会被跳过
+   */
+  std::vector<article_list> summaries_of(const std::vector<uint64_t> &ids,
+                                         size_t limit) {
+    std::vector<article_list> list;
+    std::shared_lock lock(mutex_);
+    for (uint64_t id : ids) {
+      if (list.size() >= limit) {
+        break;
+      }
+      auto it = entries_.find(id);
+      if (it != entries_.end()) {
+        list.push_back(it->second.summary);
+      }
+    }
+    return list;
+  }
+
+  /**
+   * @brief 增减文章评论数(仅内存)
+   */
+  void add_comments(uint64_t article_id, int delta) {
+    std::unique_lock lock(mutex_);
+    auto it = entries_.find(article_id);
+    if (it == entries_.end()) {
+      return;
+    }
+    auto &count = it->second.summary.comments_count;
+    count = delta < 0 && count < static_cast<uint32_t>(-delta) ? 0
+                                                               : count + delta;
+  }
+
+  /**
+   * @brief 获取一页文章列表
+   * @param group 标签组，tag_id大于0时忽略标签组，与原查询保持一致
+   * @param tag_id 标签ID，0表示不过滤
+   * @param user_id 作者ID，0表示不过滤
+   * @param after 游标分页时上一页最后一篇文章的排序键，不为空时忽略offset
+   */
+  feed_page get_page(TagGroupType group, int tag_id, uint64_t user_id,
+                     size_t offset, size_t limit,
+                     const feed_key *after = nullptr) {
+    feed_page page;
+
+    std::shared_lock lock(mutex_);
+    // 按标签过滤时使用标签下已排序的列表
+    const auto &lists = tag_id > 0 ? tag_keys_ : groups_;
+    auto it = lists.find(tag_id > 0 ? tag_id : static_cast<int>(group));
+    if (it == lists.end()) {
+      return page;
+    }
+
+    if (user_id == 0) {
+      fill_page_locked(it->second, offset, limit, after, page);
+      return page;
+    }
+
+    std::vector<feed_key> keys;
+    for (const auto &key : it->second) {
+      if (entries_.at(key.article_id).summary.author_id == user_id) {
+        keys.push_back(key);
+      }
+    }
+    fill_page_locked(keys, offset, limit, after, page);
+    return page;
+  }
+
+  /**
+   * @brief 按给定顺序获取一页文章列表，用于搜索结果分页
+   * @param ranked 按相关度排好序的文章ID，不在已发布列表中的会被跳过
+   */
+  feed_page get_ranked_page(TagGroupType group, int tag_id, uint64_t user_id,
+                            const std::vector<uint64_t> &ranked,
+                            size_t offset, size_t limit) {
+    feed_page page;
+    std::shared_lock lock(mutex_);
+    for (uint64_t id : ranked) {
+      auto it = entries_.find(id);
+      if (it == entries_.end()) {
+        continue;
+      }
+      const auto &entry = it->second;
+      if (tag_id > 0) {
+        if (!std::binary_search(entry.tags.begin(), entry.tags.end(),
+                                tag_id)) {
+          continue;
+        }
+      } else {
+        auto groups = groups_of(entry.tags);
+        if (std::find(groups.begin(), groups.end(), static_cast<int>(group)) ==
+            groups.end()) {
+          continue;
+        }
+      }
+      if (user_id > 0 && entry.summary.author_id != user_id) {
+        continue;
+      }
+      if (page.total_count >= offset && page.list.size() < limit) {
+        page.list.push_back(entry.summary);
+      }
+      page.total_count++;
+    }
+    return page;
+  }
+
+private:
+  article_feed() = default;
+  article_feed(const article_feed &) = delete;
+  article_feed &operator=(const article_feed &) = delete;
+
+  static void insert_key(std::vector<feed_key> &keys, const feed_key &key) {
+    keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+  }
+
+  static void erase_key(std::vector<feed_key> &keys, const feed_key &key) {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it != keys.end() && *it == key) {
+      keys.erase(it);
+    }
+  }
+
+  // 从已排序的keys中取一页，after不为空时从after之后开始
+  void fill_page_locked(const std::vector<feed_key> &keys, size_t offset,
+                        size_t limit, const feed_key *after,
+                        feed_page &page) const {
+    page.total_count = keys.size();
+    size_t start = offset;
+    if (after) {
+      start = std::upper_bound(keys.begin(), keys.end(), *after) - keys.begin();
+    }
+    size_t end = start;
+    for (; end < keys.size() && page.list.size() < limit; ++end) {
+      page.list.push_back(entries_.at(keys[end].article_id).summary);
+    }
+    if (end < keys.size() && !page.list.empty()) {
+      page.next = keys[end - 1];
+    }
+  }
+
+  // 文章所属的标签组(去重)
+  std::vector<int> groups_of(const std::vector<int> &tags) const {
+    std::vector<int> groups;
+    for (int tag_id : tags) {
+      int group = tags_->group_of(tag_id);
+      if (group != 0 &&
+          std::find(groups.begin(), groups.end(), group) == groups.end()) {
+        groups.push_back(group);
+      }
+    }
+    return groups;
+  }
+
+  void insert_locked(feed_row &&row) {
+    feed_entry entry{};
+    entry.key = feed_key{row.featured_weight, row.created_at, row.article_id};
+    entry.tags = parse_tag_ids(row.tag_ids);
+    entry.summary = article_list{.title = std::move(row.title),
+                                 .summary = std::move(row.summary),
+                                 .slug = std::move(row.slug),
+                                 .author_name = std::move(row.author_name),
+                                 .author_id = row.author_id,
+                                 .tag_ids = std::move(row.tag_ids),
+                                 .created_at = row.created_at,
+                                 .updated_at = row.updated_at,
+                                 .views_count = row.views_count,
+                                 .comments_count = row.comments_count,
+                                 .featured_weight = row.featured_weight};
+
+    for (int group : groups_of(entry.tags)) {
+      insert_key(groups_[group], entry.key);
+    }
+    for (int tag_id : entry.tags) {
+      insert_key(tag_keys_[tag_id], entry.key);
+    }
+    slugs_[entry.summary.slug] = row.article_id;
+    entries_[row.article_id] = std::move(entry);
+  }
+
+  bool erase_locked(std::string_view slug) {
+    auto slug_it = slugs_.find(std::string(slug));
+    if (slug_it == slugs_.end()) {
+      return false;
+    }
+    auto it = entries_.find(slug_it->second);
+    if (it != entries_.end()) {
+      const auto &entry = it->second;
+      for (int group : groups_of(entry.tags)) {
+        erase_key(groups_[group], entry.key);
+      }
+      for (int tag_id : entry.tags) {
+        erase_key(tag_keys_[tag_id], entry.key);
+      }
+      entries_.erase(it);
+    }
+    slugs_.erase(slug_it);
+    return true;
+  }
+
+  std::shared_mutex mutex_;
+  tag_catalog::snapshot_ptr tags_ = tag_catalog::instance().snapshot();
+  std::unordered_map<uint64_t, feed_entry> entries_; // article_id -> 文章
+  std::unordered_map<std::string, uint64_t> slugs_;  // slug -> article_id
+  std::unordered_map<int, std::vector<feed_key>> groups_;   // 标签组 -> 文章
+  std::unordered_map<int, std::vector<feed_key>> tag_keys_; // 标签 -> 文章
+};
+} // namespace purecpp
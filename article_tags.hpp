@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace purecpp {
+
+/**
+ * @brief 解析以竖线|分割的标签ID字符串，忽略空段和非法段
+ */
+inline std::vector<int> parse_tag_ids(std::string_view tag_ids) {
+  std::vector<int> result;
+  while (!tag_ids.empty()) {
+    auto pos = tag_ids.find('|');
+    auto part = tag_ids.substr(0, pos);
+    int tag_id = 0;
+    auto [ptr, ec] =
+        std::from_chars(part.data(), part.data() + part.size(), tag_id);
+    if (ec == std::errc{} && ptr == part.data() + part.size() && tag_id > 0) {
+      result.push_back(tag_id);
+    }
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    tag_ids.remove_prefix(pos + 1);
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+/**
+ * @brief 在以竖线|分割的标签ID字符串中加上或去掉一个标签
+ *
+ * 按整段比较，"1080"不会被当成"108"；其他标签保持原来的顺序，空段被去掉。
+ * @param added 返回true表示加上了标签，false表示去掉了
+ */
+inline std::string toggle_tag_id(std::string_view tag_ids, int tag_id,
+                                 bool &added) {
+  std::string target = std::to_string(tag_id);
+  std::string result;
+  added = true;
+  while (!tag_ids.empty()) {
+    auto pos = tag_ids.find('|');
+    auto part = tag_ids.substr(0, pos);
+    if (part == target) {
+      added = false;
+    } else if (!part.empty()) {
+      if (!result.empty()) {
+        result.push_back('|');
+      }
+      result.append(part);
+    }
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    tag_ids.remove_prefix(pos + 1);
+  }
+  if (added) {
+    if (!result.empty()) {
+      result.push_back('|');
+    }
+    result.append(target);
+  }
+  return result;
+}
+
+/**
+ * @brief 文章标签关联表
+ *
+ * 数据库中的article_tags表是文章和标签的关联关系，和articles.tag_ids
+ * 在同一个事务中写入，按标签查询文章时不再对tag_ids做LIKE匹配。
+ * 内存中每个标签下已发布文章的列表由article_feed按排序键维护。
+ */
+class article_tag_index {
+public:
+  static article_tag_index &instance() {
+    static article_tag_index instance;
+    return instance;
+  }
+
+  /**
+   * @brief article_tags表为空时根据articles的tag_ids回填
+   */
+  bool init() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "article tag index init failed: no db connection";
+      return false;
+    }
+
+    auto rows = conn->select(col(&article_tags_t::id))
+                    .from<article_tags_t>()
+                    .limit(ormpp::token)
+                    .collect(1);
+    if (rows.empty()) {
+      size_t count = 0;
+      auto articles =
+          conn->select(col(&articles_t::article_id), col(&articles_t::tag_ids))
+              .from<articles_t>()
+              .collect();
+      conn->begin();
+      for (const auto &article : articles) {
+        for (int tag_id : parse_tag_ids(std::get<1>(article))) {
+          article_tags_t row{.article_id = std::get<0>(article),
+                             .tag_id = tag_id};
+          if (conn->insert(row) == 0) {
+            conn->rollback();
+            CINATRA_LOG_ERROR << "backfill article_tags failed: "
+                              << conn->get_last_error();
+            return false;
+          }
+          count++;
+        }
+      }
+      conn->commit();
+      CINATRA_LOG_INFO << "article_tags backfilled with " << count << " rows";
+    }
+    return true;
+  }
+
+  /**
+   * @brief 把文章的标签写入article_tags表，在调用方写文章的事务中执行，
+   * 和articles.tag_ids一起提交或回滚
+   * @param tag_ids 以竖线|分割的标签ID
+   */
+  static bool write(dbng<mysql> &conn, uint64_t article_id,
+                    std::string_view tag_ids) {
+    if (!conn.delete_records_s<article_tags_t>("article_id = ?", article_id)) {
+      CINATRA_LOG_ERROR << "sync article_tags failed: "
+                        << conn.get_last_error();
+      return false;
+    }
+    for (int tag_id : parse_tag_ids(tag_ids)) {
+      article_tags_t row{.article_id = article_id, .tag_id = tag_id};
+      if (conn.insert(row) == 0) {
+        CINATRA_LOG_ERROR << "sync article_tags failed: "
+                          << conn.get_last_error();
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  article_tag_index() = default;
+  article_tag_index(const article_tag_index &) = delete;
+  article_tag_index &operator=(const article_tag_index &) = delete;
+};
+} // namespace purecpp
@@ -1,10 +1,21 @@
 #pragma once
 
+#include "article_feed.hpp"
 #include "articles_dto.hpp"
+#include "blob_store.hpp"
 #include "common.hpp"
+#include "count_cache.hpp"
+#include "detail_cache.hpp"
+#include "search_index.hpp"
+#include "slug_index.hpp"
+#include "trending.hpp"
 #include "user_aspects.hpp"
+#include "view_counter.hpp"
 
+#include <charconv>
 #include <random>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace cinatra;
 
@@ -22,20 +33,7 @@ struct article_page_request {
   int current_page;
   int per_page;
   std::string search; // 搜索关键词
-};
-
-struct article_list {
-  std::string title;
-  std::string summary;
-  std::string slug;
-  std::string author_name;
-  uint64_t author_id;
-  std::string tag_ids;
-  uint64_t created_at;
-  uint64_t updated_at;
-  uint32_t views_count;
-  uint32_t comments_count;
-  int featured_weight;
+  std::string cursor; // 分页游标，不为空时忽略current_page，搜索时不支持
 };
 
 struct pending_article_list {
@@ -49,6 +47,7 @@ struct pending_article_list {
   uint64_t updated_at;
   uint32_t views_count;
   uint32_t comments_count;
+  uint64_t article_id;
 };
 
 static std::string_view REVIEW_REJECTED = "rejected"; // 审核_已拒绝
@@ -197,6 +196,8 @@ public:
       return;
     }
 
+    // 文章、标签关联和上传文件引用在同一个事务中写入
+    conn->begin();
     int retry = 5;
     uint64_t article_id = 0;
     for (; retry > 0; retry--) {
@@ -209,10 +210,27 @@ public:
 
     if (retry == 0) {
       auto err = conn->get_last_error();
+      conn->rollback();
       CINATRA_LOG_ERROR << "提交文章失败: " << err;
       set_server_internel_error(resp);
       return;
     }
+    if (!article_tag_index::write(*conn, article_id, article.tag_ids) ||
+        !blob_store::write_refs(*conn, blob_owner::article, article_id,
+                                article.content)) {
+      conn->rollback();
+      set_server_internel_error(resp);
+      return;
+    }
+    conn->commit();
+
+    std::string_view new_slug(article.slug.data(), article.slug.size());
+    slug_index::instance().upsert(
+        new_slug, slug_entry{article_id, user_id,
+                             article_state::pending_review, false});
+    count_cache::instance().invalidate(count_keys::my_articles(user_id));
+    count_cache::instance().invalidate(count_keys::pending_articles());
+    search_index::instance().refresh(new_slug);
 
     resp.set_status_and_content(status_type::ok,
                                 make_success("文章提交成功，等待审核"));
@@ -227,18 +245,28 @@ public:
     }
 
     auto slug = it->second;
+    if (!is_valid_slug(slug)) {
+      resp.set_status_and_content(status_type::not_found,
+                                  make_error("文章不存在或已被删除"));
+      return;
+    }
+
+    // 浏览量先在内存中累加，由后台定期批量写回数据库
+    if (auto cached = detail_cache::instance().hit(slug)) {
+      view_counter::instance().increment(slug);
+      article_feed::instance().add_views(slug, 1);
+      resp.set_status_and_content(
+          status_type::ok, make_data_raw(*cached, "获取文章详情成功"));
+      return;
+    }
+
+    auto version = detail_cache::instance().version();
     auto conn = connection_pool<dbng<mysql>>::instance().get();
     if (conn == nullptr) {
       set_server_internel_error(resp);
       return;
     }
 
-    // 先更新浏览量
-    conn->execute(
-        "UPDATE `articles` SET views_count = views_count + 1 WHERE slug = '" +
-        std::string(slug) + "'");
-
-    // 再获取文章详情
     auto list =
         conn->select(col(&articles_t::title), col(&articles_t::abstraction),
                      col(&articles_t::content), col(&users_t::user_name),
@@ -253,24 +281,41 @@ public:
                    col(&articles_t::is_deleted) == 0)
             .collect<article_detail>(slug);
 
-    if (!list.empty()) {
-      std::string json = make_data(std::move(list[0]), "获取文章详情成功");
-      resp.set_status_and_content(status_type::ok, std::move(json));
-    } else {
+    if (list.empty()) {
       resp.set_status_and_content(status_type::not_found,
                                   make_error("文章不存在或已被删除"));
+      return;
     }
+
+    view_counter::instance().increment(slug);
+    article_feed::instance().add_views(slug, 1);
+    auto &detail = list[0];
+    detail.views_count += view_counter::instance().pending(slug);
+
+    std::string detail_json;
+    iguana::to_json(detail, detail_json);
+    detail_cache::instance().put(slug, detail_json, detail.views_count,
+                                 version);
+    resp.set_status_and_content(
+        status_type::ok, make_data_raw(detail_json, "获取文章详情成功"));
   }
 
   void edit_article(coro_http_request &req, coro_http_response &resp) {
-    edit_article_info info =
-        std::any_cast<edit_article_info>(req.get_user_data());
+    edit_article_info info = get_request_data<edit_article_info>(req);
     auto conn = connection_pool<dbng<mysql>>::instance().get();
     if (conn == nullptr) {
       set_server_internel_error(resp);
       return;
     }
 
+    // 文章ID，用于更新标签关联和上传文件引用
+    auto entry = slug_index::instance().find(info.slug);
+    if (!entry) {
+      resp.set_status_and_content(status_type::not_found,
+                                  make_error("文章不存在或已被删除"));
+      return;
+    }
+
     // 文章编辑以后，上次审核结果也删掉
     articles_t article{};
     article.tag_ids = info.tag_ids;
@@ -286,6 +331,8 @@ public:
     // 使用安全的字符串拼接，避免SQL注入风险
     std::string slug = "slug='";
     slug.append(info.slug).append("'");
+    // 文章、标签关联和上传文件引用在同一个事务中更新
+    conn->begin();
     int n =
         conn->update_some<&articles_t::tag_ids, &articles_t::title,
                           &articles_t::abstraction, &articles_t::content,
@@ -293,21 +340,27 @@ public:
                           &articles_t::review_comment, &articles_t::review_date,
                           &articles_t::updated_at>(article, slug);
 
-    if (n == 0) {
+    if (n == 0 ||
+        !article_tag_index::write(*conn, entry->article_id, info.tag_ids) ||
+        !blob_store::write_refs(*conn, blob_owner::article, entry->article_id,
+                                info.content)) {
+      conn->rollback();
       set_server_internel_error(resp);
       return;
     }
+    conn->commit();
+
+    slug_index::instance().set_state(info.slug, article_state::pending_review);
+    // 编辑后文章重新进入待审核状态，从已发布列表中移除
+    article_feed::instance().refresh(info.slug);
+    detail_cache::instance().invalidate(info.slug);
+    count_cache::instance().invalidate(count_keys::pending_articles());
+    search_index::instance().refresh(info.slug);
     std::string json = make_success("修改成功");
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
 
   void get_articles(coro_http_request &req, coro_http_response &resp) {
-    auto conn = connection_pool<dbng<mysql>>::instance().get();
-    if (conn == nullptr) {
-      set_server_internel_error(resp);
-      return;
-    }
-
     // 从请求体中获取分页信息
     auto body = req.get_body();
     article_page_request page_req{};
@@ -329,86 +382,46 @@ public:
       per_page = page_req.per_page;
     }
 
-    // 查询TECH_ARTICLES分组下的所有标签ID
-    auto tech_articles_tags =
-        conn->select(col(&tags_t::tag_id))
-            .from<tags_t>()
-            .where(col(&tags_t::tag_group) ==
-                   static_cast<int>(TagGroupType::TECH_ARTICLES))
-            .collect();
+    // 没有搜索条件时直接从内存列表获取
+    if (page_req.search.empty()) {
+      std::optional<feed_key> after;
+      if (!page_req.cursor.empty()) {
+        auto cursor = decode_cursor(page_req.cursor);
+        if (!cursor) {
+          resp.set_status_and_content(status_type::bad_request,
+                                      make_error("无效的分页游标"));
+          return;
+        }
+        after = to_feed_key(*cursor);
+      }
 
-    if (tech_articles_tags.empty()) {
-      // 如果没有TECH_ARTICLES分组的标签，则返回空列表
+      auto result = article_feed::instance().get_page(
+          TagGroupType::TECH_ARTICLES, page_req.tag_id, page_req.user_id,
+          (page - 1) * per_page, per_page, after ? &*after : nullptr);
       std::string json =
-          make_data(std::vector<article_list>(), "获取文章列表成功", 0);
+          make_data(std::move(result.list), "获取文章列表成功",
+                    result.total_count, next_cursor_of(result));
+      if (json.empty()) {
+        set_server_internel_error(resp);
+        return;
+      }
       resp.set_status_and_content(status_type::ok, std::move(json));
       return;
     }
 
-    // 构建查询条件：文章已发布且未删除，并且tag_ids包含至少一个TECH_ARTICLES分组的标签
-    auto where_cond0 = col(&articles_t::is_deleted) == 0 &&
-                       col(&articles_t::status) == PUBLISHED.data();
-
-    // 构建标签ID的OR条件
-    bool first = true;
-    decltype(where_cond0) col_tags;
-    for (const auto &tag : tech_articles_tags) {
-      int tag_id = std::get<0>(tag);
-      if (first) {
-        col_tags =
-            col(&articles_t::tag_ids).like("%" + std::to_string(tag_id) + "%");
-        first = false;
-      } else {
-        col_tags =
-            col_tags ||
-            col(&articles_t::tag_ids).like("%" + std::to_string(tag_id) + "%");
-      }
+    // 搜索走全文索引，按相关度排序，标签和作者过滤以及分页由内存列表完成
+    auto hits = search_index::instance().search(page_req.search, PUBLISHED);
+    std::vector<uint64_t> ranked;
+    ranked.reserve(hits.size());
+    for (const auto &hit : hits) {
+      ranked.push_back(hit.article_id);
     }
-    auto where_cond = where_cond0 && col_tags;
-
-    // tag_ids字段存储多个标签
-    if (page_req.tag_id > 0) {
-      where_cond = where_cond0 &&
-                   (col(&articles_t::tag_ids)
-                        .like("%" + std::to_string(page_req.tag_id) + "%"));
-    }
-    if (page_req.user_id > 0) {
-      where_cond =
-          where_cond && (col(&articles_t::author_id) == page_req.user_id);
-    }
-    // 搜索功能
-    if (!page_req.search.empty()) {
-      std::string search_pattern = "%" + page_req.search + "%";
-      where_cond = where_cond && col(&articles_t::content).like(search_pattern);
-    }
-    // 计算总记录数(根据查询条件)
-    size_t total_count =
-        conn->select(ormpp::count())
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond)
-            .collect();
-
-    auto select_cond =
-        conn->select(col(&articles_t::title), col(&articles_t::abstraction),
-                     col(&articles_t::slug), col(&users_t::user_name),
-                     col(&articles_t::author_id), col(&articles_t::tag_ids),
-                     col(&articles_t::created_at), col(&articles_t::updated_at),
-                     col(&articles_t::views_count),
-                     col(&articles_t::comments_count),
-                     col(&articles_t::featured_weight))
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond);
-    size_t limit = per_page;
-    size_t offset = (page - 1) * per_page;
-    auto list = select_cond.order_by(col(&articles_t::created_at).desc())
-                    .limit(ormpp::token)
-                    .offset(ormpp::token)
-                    .collect<article_list>(limit, offset);
 
-    std::string json =
-        make_data(std::move(list), "获取文章列表成功", total_count);
+    auto result = article_feed::instance().get_ranked_page(
+        TagGroupType::TECH_ARTICLES, page_req.tag_id, page_req.user_id, ranked,
+        (page - 1) * per_page, per_page);
+    std::string json = make_data(std::move(result.list), "获取文章列表成功",
+                                 result.total_count);
     if (json.empty()) {
       set_server_internel_error(resp);
       return;
@@ -427,6 +440,7 @@ public:
     size_t limit = 20; // will update, it's from web front end.
     size_t offset = 0; // will update, it's from web front end.
     std::string search;
+    std::string cursor;
 
     // 从请求体中获取分页和搜索参数
     auto body = req.get_body();
@@ -443,6 +457,7 @@ public:
           offset = (page_req.current_page - 1) * limit;
         }
         search = page_req.search;
+        cursor = page_req.cursor;
       }
     }
 
@@ -450,37 +465,117 @@ public:
     auto where_cond = col(&articles_t::is_deleted) == 0 &&
                       col(&articles_t::status) == PENDING_REVIEW.data();
 
-    // 搜索功能
+    // 搜索功能：从全文索引取出一页slug，再按slug查询这一页文章
     if (!search.empty()) {
-      std::string search_pattern = "%" + search + "%";
-      where_cond = where_cond && col(&articles_t::content).like(search_pattern);
+      auto hits = search_index::instance().search(search, PENDING_REVIEW);
+      std::vector<pending_article_list> list;
+      if (offset < hits.size()) {
+        size_t end = std::min(hits.size(), offset + limit);
+        decltype(where_cond) slug_cond;
+        for (size_t i = offset; i < end; i++) {
+          if (i == offset) {
+            slug_cond = col(&articles_t::slug) == hits[i].slug;
+          } else {
+            slug_cond = slug_cond || col(&articles_t::slug) == hits[i].slug;
+          }
+        }
+        list = conn->select(col(&articles_t::title),
+                            col(&articles_t::abstraction),
+                            col(&articles_t::content), col(&articles_t::slug),
+                            col(&users_t::user_name),
+                            col(&articles_t::tag_ids),
+                            col(&articles_t::created_at),
+                            col(&articles_t::updated_at),
+                            col(&articles_t::views_count),
+                            col(&articles_t::comments_count),
+                            col(&articles_t::article_id))
+                   .from<articles_t>()
+                   .inner_join(col(&articles_t::author_id), col(&users_t::id))
+                   .where(where_cond && slug_cond)
+                   .collect<pending_article_list>();
+
+        // 按相关度恢复顺序
+        std::unordered_map<std::string_view, size_t> ranks;
+        for (size_t i = offset; i < end; i++) {
+          ranks.emplace(hits[i].slug, i);
+        }
+        auto rank_of = [&](std::string_view slug) {
+          auto it = ranks.find(slug);
+          return it == ranks.end() ? end : it->second;
+        };
+        std::sort(list.begin(), list.end(),
+                  [&](const auto &a, const auto &b) {
+                    return rank_of(a.slug) < rank_of(b.slug);
+                  });
+      }
+
+      std::string json =
+          make_data(std::move(list), "获取待审核文章列表成功", hits.size());
+      if (json.empty()) {
+        set_server_internel_error(resp);
+        return;
+      }
+      resp.set_status_and_content(status_type::ok, std::move(json));
+      return;
     }
 
-    // 计算总记录数
-    size_t total_count =
-        conn->select(ormpp::count())
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond)
-            .collect();
+    // 计算总记录数，游标分页时不再重复计算。待审核文章的总数在后台刷新，
+    // 刷新期间返回旧值
+    count_result total{};
+    if (cursor.empty()) {
+      total = count_cache::instance().get(
+          count_keys::pending_articles(),
+          []() -> std::optional<size_t> {
+            auto conn = connection_pool<dbng<mysql>>::instance().get();
+            if (conn == nullptr) {
+              return std::nullopt;
+            }
+            size_t count =
+                conn->select(ormpp::count())
+                    .from<articles_t>()
+                    .inner_join(col(&articles_t::author_id), col(&users_t::id))
+                    .where(col(&articles_t::is_deleted) == 0 &&
+                           col(&articles_t::status) == PENDING_REVIEW.data())
+                    .collect();
+            return count;
+          },
+          true);
+    } else {
+      auto position = decode_cursor(cursor);
+      if (!position) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("无效的分页游标"));
+        return;
+      }
+      // 按文章ID排序，ID唯一，从上一页最后一条之后继续不会重复或遗漏
+      where_cond = where_cond && col(&articles_t::article_id) < position->id;
+      offset = 0;
+    }
 
+    // 多取一条用于判断是否还有下一页
     auto list =
         conn->select(col(&articles_t::title), col(&articles_t::abstraction),
                      col(&articles_t::content), col(&articles_t::slug),
                      col(&users_t::user_name), col(&articles_t::tag_ids),
                      col(&articles_t::created_at), col(&articles_t::updated_at),
                      col(&articles_t::views_count),
-                     col(&articles_t::comments_count))
+                     col(&articles_t::comments_count),
+                     col(&articles_t::article_id))
             .from<articles_t>()
             .inner_join(col(&articles_t::author_id), col(&users_t::id))
             .where(where_cond)
-            .order_by(col(&articles_t::created_at).desc())
+            .order_by(col(&articles_t::article_id).desc())
             .limit(ormpp::token)
             .offset(ormpp::token)
-            .collect<pending_article_list>(limit, offset);
+            .collect<pending_article_list>(limit + 1, offset);
+    auto next_cursor =
+        take_page(list, limit, [](const pending_article_list &item) {
+          return page_cursor{0, item.created_at, item.article_id};
+        });
 
     std::string json =
-        make_data(std::move(list), "获取待审核文章列表成功", total_count);
+        make_data(std::move(list), "获取待审核文章列表成功", total.count,
+                  std::move(next_cursor), total.estimated);
     if (json.empty()) {
       set_server_internel_error(resp);
       return;
@@ -572,62 +667,61 @@ public:
       set_server_internel_error(resp);
       return;
     }
+    slug_index::instance().set_state(request.slug,
+                                     to_article_state(article.status));
+    article_feed::instance().refresh(request.slug);
+    detail_cache::instance().invalidate(request.slug);
+    count_cache::instance().invalidate(count_keys::pending_articles());
+    search_index::instance().refresh(request.slug);
     std::string json = make_success("审核成功");
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
 
-  void upload_file(coro_http_request &req, coro_http_response &resp) {
-    auto info = std::any_cast<upload_file_info>(req.get_user_data());
+  async_simple::coro::Lazy<void> upload_file(coro_http_request &req,
+                                             coro_http_response &resp) {
+    auto info = get_request_data<upload_file_info>(req);
 
-    // 解码base64图片数据
-    auto file_data = cinatra::base64_decode(std::string(info.file_data));
-    if (!file_data.has_value()) {
-      resp.set_status_and_content(status_type::bad_request,
-                                  make_error("base64图片数据解码失败"));
-      return;
-    }
+    std::string ext(cinatra::get_extension(info.filename));
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
 
-    std::string &file_data_str = file_data.value();
-
-    if (file_data_str.size() > MAX_FILE_SIZE) {
+    // 先写入临时文件，检查通过后按内容哈希保存
+    auto sink = blob_store::make_sink(ext, MAX_FILE_SIZE);
+    if (!sink.open()) {
       resp.set_status_and_content(
-          status_type::bad_request,
-          make_error(PURECPP_ERROR_UPLOAD_FILE_SIZE_EXCEED));
-      return;
+          status_type::internal_server_error,
+          make_error(PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED));
+      co_return;
     }
 
-    std::filesystem::path upload_dir = "html/uploads/articles";
-    if (!std::filesystem::exists(upload_dir)) {
-      std::filesystem::create_directories(upload_dir);
+    std::string_view err;
+    if (is_binary_upload(req)) {
+      err = co_await receive_upload(req, sink);
+    } else {
+      // 解码base64图片数据
+      auto file_data = cinatra::base64_decode(std::string(info.file_data));
+      if (!file_data.has_value()) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("base64图片数据解码失败"));
+        co_return;
+      }
+      err = co_await sink.write(file_data.value());
     }
-
-    auto ext = cinatra::get_extension(info.filename);
-
-    // 生成唯一文件名
-    std::string unique_filename =
-        std::to_string(get_timestamp_milliseconds()) + std::string(ext);
-    std::filesystem::path file_path = upload_dir / unique_filename;
-
-    // 保存文件
-    std::ofstream out_file(file_path, std::ios::binary);
-    if (!out_file) {
-      resp.set_status_and_content(status_type::internal_server_error,
-                                  make_error("保存文件失败"));
-      return;
+    if (err.empty()) {
+      err = blob_store::instance().commit(sink);
+    }
+    if (!err.empty()) {
+      set_upload_error(resp, err);
+      co_return;
     }
-    out_file.write(reinterpret_cast<const char *>(file_data_str.data()),
-                   file_data_str.size());
-    out_file.close();
 
-    // 生成文件URL
-    std::string file_url = "/uploads/articles/" + unique_filename;
     // 构建响应
     struct upload_response {
       std::string url;
       std::string filename;
     };
 
-    upload_response data{file_url, unique_filename};
+    upload_response data{blob_store::url_of(sink),
+                         sink.hash() + sink.ext()};
     std::string json = make_data(data, "文件上传成功");
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
@@ -693,15 +787,34 @@ public:
     auto where_cond = col(&articles_t::author_id) == page_req.user_id &&
                       col(&articles_t::is_deleted) == 0;
 
-    // 计算总记录数
-    size_t total_count = conn->select(ormpp::count())
-                             .from<articles_t>()
-                             .where(where_cond)
-                             .collect();
-
-    // 计算分页参数
+    // 计算总记录数，游标分页时不再重复计算
+    count_result total{};
+    if (page_req.cursor.empty()) {
+      total = count_cache::instance().get(
+          count_keys::my_articles(page_req.user_id),
+          [&]() -> std::optional<size_t> {
+            size_t count = conn->select(ormpp::count())
+                               .from<articles_t>()
+                               .where(where_cond)
+                               .collect();
+            return count;
+          });
+    }
+
+    // 计算分页参数，多取一条用于判断是否还有下一页
     size_t limit = per_page;
     size_t offset = (page - 1) * per_page;
+    if (!page_req.cursor.empty()) {
+      auto cursor = decode_cursor(page_req.cursor);
+      if (!cursor) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("无效的分页游标"));
+        return;
+      }
+      // 按文章ID排序，ID唯一，从上一页最后一条之后继续不会重复或遗漏
+      where_cond = where_cond && col(&articles_t::article_id) < cursor->id;
+      offset = 0;
+    }
 
     // 获取用户的文章列表
     auto articles_list =
@@ -714,13 +827,18 @@ public:
                      col(&articles_t::review_comment))
             .from<articles_t>()
             .where(where_cond)
-            .order_by(col(&articles_t::created_at).desc())
+            .order_by(col(&articles_t::article_id).desc())
             .limit(ormpp::token)
             .offset(ormpp::token)
-            .collect<my_article_item>(limit, offset);
+            .collect<my_article_item>(limit + 1, offset);
+    auto next_cursor =
+        take_page(articles_list, limit, [](const my_article_item &item) {
+          return page_cursor{0, item.created_at, item.article_id};
+        });
 
-    std::string json = make_data(std::move(articles_list),
-                                 "获取用户文章列表成功", total_count);
+    std::string json =
+        make_data(std::move(articles_list), "获取用户文章列表成功",
+                  total.count, std::move(next_cursor), total.estimated);
     if (json.empty()) {
       set_server_internel_error(resp);
       return;
@@ -769,26 +887,15 @@ public:
       return;
     }
 
-    auto conn = connection_pool<dbng<mysql>>::instance().get();
-    if (conn == nullptr) {
-      set_server_internel_error(resp);
-      return;
-    }
-
     // 检查文章是否存在，并且是否是当前用户的文章
-    auto articles = conn->select(col(&articles_t::author_id))
-                        .from<articles_t>()
-                        .where(col(&articles_t::slug).param() &&
-                               col(&articles_t::is_deleted).param())
-                        .collect(request.slug, 0);
-
-    if (articles.empty()) {
+    auto entry = slug_index::instance().find(request.slug);
+    if (!entry || entry->is_deleted) {
       resp.set_status_and_content(status_type::not_found,
                                   make_error("文章不存在或已被删除"));
       return;
     }
 
-    uint64_t article_author_id = std::get<0>(articles.front());
+    uint64_t article_author_id = entry->author_id;
 
     // 检查当前用户是否是文章作者
     if (current_user_id != article_author_id) {
@@ -797,16 +904,33 @@ public:
       return;
     }
 
-    // 标记文章为已删除
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      set_server_internel_error(resp);
+      return;
+    }
+
+    // 标记文章为已删除，同时删除文章对上传文件的引用
     articles_t article;
     article.is_deleted = true;
     article.updated_at = get_timestamp_milliseconds();
+    conn->begin();
     int n = conn->update_some<&articles_t::is_deleted, &articles_t::updated_at>(
         article, "slug='" + request.slug + "'");
-    if (n == 0) {
+    if (n == 0 || !blob_store::write_refs(*conn, blob_owner::article,
+                                          entry->article_id, "")) {
+      conn->rollback();
       set_server_internel_error(resp);
       return;
     }
+    conn->commit();
+    slug_index::instance().mark_deleted(request.slug);
+    article_feed::instance().refresh(request.slug);
+    detail_cache::instance().invalidate(request.slug);
+    count_cache::instance().invalidate(count_keys::pending_articles());
+    count_cache::instance().invalidate(
+        count_keys::my_articles(article_author_id));
+    search_index::instance().refresh(request.slug);
 
     std::string json = make_success("文章删除成功");
     resp.set_status_and_content(status_type::ok, std::move(json));
@@ -814,204 +938,15 @@ public:
 
   // 获取社区服务文章
   void get_community_service(coro_http_request &req, coro_http_response &resp) {
-    auto conn = connection_pool<dbng<mysql>>::instance().get();
-    if (conn == nullptr) {
-      set_server_internel_error(resp);
-      return;
-    }
-
-    // 从请求体中获取分页信息
-    auto body = req.get_body();
-    article_page_request page_req{};
-    std::error_code ec;
-    if (!body.empty()) {
-      iguana::from_json(page_req, body, ec);
-    }
-
-    int page = 1;
-    int per_page = 10;
-
-    if (page_req.current_page > 0) {
-      page = page_req.current_page;
-    }
-    if (page_req.per_page > 0 && page_req.per_page <= 50) {
-      per_page = page_req.per_page;
-    }
-
-    // 查询SERVICES分组下的所有标签ID
-    auto services_tags = conn->select(col(&tags_t::tag_id))
-                             .from<tags_t>()
-                             .where(col(&tags_t::tag_group) ==
-                                    static_cast<int>(TagGroupType::SERVICES))
-                             .collect();
-
-    if (services_tags.empty()) {
-      // 如果没有SERVICES分组的标签，则返回空列表
-      std::string json =
-          make_data(std::vector<article_list>(), "获取社区服务文章列表成功", 0);
-      resp.set_status_and_content(status_type::ok, std::move(json));
-      return;
-    }
-
-    // 构建查询条件：文章已发布且未删除，并且tag_ids包含至少一个SERVICES分组的标签
-    auto where_cond = col(&articles_t::is_deleted) == 0 &&
-                      col(&articles_t::status) == PUBLISHED.data();
-
-    // 构建标签ID的OR条件
-    bool first = true;
-    decltype(where_cond) col_tags;
-    for (const auto &tag : services_tags) {
-      int tag_id = std::get<0>(tag);
-      if (first) {
-        col_tags =
-            col(&articles_t::tag_ids).like("%" + std::to_string(tag_id) + "%");
-        first = false;
-      } else {
-        col_tags =
-            col_tags ||
-            col(&articles_t::tag_ids).like("%" + std::to_string(tag_id) + "%");
-      }
-    }
-    where_cond = where_cond && col_tags;
-
-    // 计算总记录数
-    size_t total_count =
-        conn->select(ormpp::count())
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond)
-            .collect();
-
-    // 计算分页参数
-    size_t limit = per_page;
-    size_t offset = (page - 1) * per_page;
-
-    // 获取社区服务文章列表
-    auto articles_list =
-        conn->select(col(&articles_t::title), col(&articles_t::abstraction),
-                     col(&articles_t::slug), col(&users_t::user_name),
-                     col(&articles_t::author_id), col(&articles_t::tag_ids),
-                     col(&articles_t::created_at), col(&articles_t::updated_at),
-                     col(&articles_t::views_count),
-                     col(&articles_t::comments_count))
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond)
-            .order_by(col(&articles_t::created_at).desc())
-            .limit(ormpp::token)
-            .offset(ormpp::token)
-            .collect<article_list>(limit, offset);
-
-    std::string json = make_data(std::move(articles_list),
-                                 "获取社区服务文章列表成功", total_count);
-    if (json.empty()) {
-      set_server_internel_error(resp);
-      return;
-    }
-
-    resp.set_status_and_content(status_type::ok, std::move(json));
+    get_group_articles(req, resp, TagGroupType::SERVICES,
+                       "获取社区服务文章列表成功");
   }
 
   // 获取purecpp大会文章
   void get_purecpp_conference(coro_http_request &req,
                               coro_http_response &resp) {
-    auto conn = connection_pool<dbng<mysql>>::instance().get();
-    if (conn == nullptr) {
-      set_server_internel_error(resp);
-      return;
-    }
-
-    // 从请求体中获取分页信息
-    auto body = req.get_body();
-    article_page_request page_req{};
-    std::error_code ec;
-    if (!body.empty()) {
-      iguana::from_json(page_req, body, ec);
-    }
-
-    int page = 1;
-    int per_page = 10;
-
-    if (page_req.current_page > 0) {
-      page = page_req.current_page;
-    }
-    if (page_req.per_page > 0 && page_req.per_page <= 50) {
-      per_page = page_req.per_page;
-    }
-
-    // 查询CPP_PARTY分组下的所有标签ID
-    auto cpp_party_tags = conn->select(col(&tags_t::tag_id))
-                              .from<tags_t>()
-                              .where(col(&tags_t::tag_group) ==
-                                     static_cast<int>(TagGroupType::CPP_PARTY))
-                              .collect();
-
-    if (cpp_party_tags.empty()) {
-      // 如果没有CPP_PARTY分组的标签，则返回空列表
-      std::string json = make_data(std::vector<article_list>(),
-                                   "获取purecpp大会文章列表成功", 0);
-      resp.set_status_and_content(status_type::ok, std::move(json));
-      return;
-    }
-
-    // 构建查询条件：文章已发布且未删除，并且tag_ids包含至少一个CPP_PARTY分组的标签
-    auto where_cond = col(&articles_t::is_deleted) == 0 &&
-                      col(&articles_t::status) == PUBLISHED.data();
-
-    // 构建标签ID的OR条件
-    bool first = true;
-    decltype(where_cond) col_tags;
-    for (const auto &tag : cpp_party_tags) {
-      int tag_id = std::get<0>(tag);
-      if (first) {
-        col_tags =
-            col(&articles_t::tag_ids).like("%" + std::to_string(tag_id) + "%");
-        first = false;
-      } else {
-        col_tags =
-            col_tags ||
-            col(&articles_t::tag_ids).like("%" + std::to_string(tag_id) + "%");
-      }
-    }
-    where_cond = where_cond && col_tags;
-
-    // 计算总记录数
-    size_t total_count =
-        conn->select(ormpp::count())
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond)
-            .collect();
-
-    // 计算分页参数
-    size_t limit = per_page;
-    size_t offset = (page - 1) * per_page;
-
-    // 获取purecpp大会文章列表
-    auto articles_list =
-        conn->select(col(&articles_t::title), col(&articles_t::abstraction),
-                     col(&articles_t::slug), col(&users_t::user_name),
-                     col(&articles_t::author_id), col(&articles_t::tag_ids),
-                     col(&articles_t::created_at), col(&articles_t::updated_at),
-                     col(&articles_t::views_count),
-                     col(&articles_t::comments_count),
-                     col(&articles_t::featured_weight))
-            .from<articles_t>()
-            .inner_join(col(&articles_t::author_id), col(&users_t::id))
-            .where(where_cond)
-            .order_by(col(&articles_t::created_at).desc())
-            .limit(ormpp::token)
-            .offset(ormpp::token)
-            .collect<article_list>(limit, offset);
-
-    std::string json = make_data(std::move(articles_list),
-                                 "获取purecpp大会文章列表成功", total_count);
-    if (json.empty()) {
-      set_server_internel_error(resp);
-      return;
-    }
-
-    resp.set_status_and_content(status_type::ok, std::move(json));
+    get_group_articles(req, resp, TagGroupType::CPP_PARTY,
+                       "获取purecpp大会文章列表成功");
   }
 
   // 处理文章加精华/取消精华
@@ -1068,11 +1003,18 @@ public:
       return;
     }
 
-    // 获取当前文章的featured_weight值
+    auto entry = slug_index::instance().find(request.slug);
+    if (!entry || entry->is_deleted) {
+      resp.set_status_and_content(status_type::not_found,
+                                  make_error("文章不存在或已被删除"));
+      return;
+    }
+    uint64_t article_id = entry->article_id;
+
+    // 获取当前文章的标签
     auto article_vect = conn->select(col(&articles_t::tag_ids))
                             .from<articles_t>()
-                            .where(col(&articles_t::slug) == request.slug &&
-                                   col(&articles_t::is_deleted) == 0)
+                            .where(col(&articles_t::article_id) == article_id)
                             .collect();
     if (article_vect.empty()) {
       resp.set_status_and_content(status_type::not_found,
@@ -1080,18 +1022,10 @@ public:
       return;
     }
 
-    std::string current_tag_ids = std::get<0>(article_vect.front());
-    std::string new_tag_ids = current_tag_ids;
-    if (current_tag_ids.find("108") != std::string::npos) {
-      new_tag_ids.erase(new_tag_ids.find("108"), 3);
-    } else {
-      new_tag_ids += ((current_tag_ids.length() > 0 &&
-                       current_tag_ids.at(current_tag_ids.length() - 1) == '|')
-                          ? "108"
-                          : "|108");
-    }
-
-    if (new_tag_ids.length() < 3) {
+    bool featured = false;
+    std::string new_tag_ids = toggle_tag_id(std::get<0>(article_vect.front()),
+                                            featured_tag_id, featured);
+    if (new_tag_ids.empty()) {
       resp.set_status_and_content(
           status_type::bad_request,
           make_error("文章只有‘社区精华’标签，不能取消精华，文章标签不能为空"));
@@ -1103,36 +1037,114 @@ public:
     article.tag_ids = new_tag_ids;
     article.updated_at = get_timestamp_milliseconds();
 
+    conn->begin();
     int n = conn->update_some<&articles_t::tag_ids, &articles_t::updated_at>(
         article, "slug='" + request.slug + "'");
 
-    if (n == 0) {
+    if (n == 0 || !article_tag_index::write(*conn, article_id, new_tag_ids)) {
+      conn->rollback();
       set_server_internel_error(resp);
       return;
     }
+    conn->commit();
+    article_feed::instance().refresh(request.slug);
+    detail_cache::instance().invalidate(request.slug);
 
-    std::string message = (new_tag_ids.find("108") != std::string::npos)
-                              ? "文章已成功加精华"
-                              : "文章已取消精华";
+    if (featured) {
+      trending::instance().add_featured(article_id);
+    }
+    std::string message = featured ? "文章已成功加精华" : "文章已取消精华";
     std::string json = make_success(message);
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
 
-  // 获取统计数据
-  void get_stats(coro_http_request &req, coro_http_response &resp) {
-    auto &config = purecpp_config::get_instance();
-    auto conn = connection_pool<dbng<mysql>>::instance().get();
-    if (conn == nullptr) {
+  // 获取热门文章，按近期浏览、评论和加精华的衰减分数排序
+  void get_trending_articles(coro_http_request &req,
+                             coro_http_response &resp) {
+    size_t limit = 10;
+    auto limit_str = req.get_query_value("limit");
+    if (!limit_str.empty()) {
+      size_t value = 0;
+      auto [ptr, ec] = std::from_chars(
+          limit_str.data(), limit_str.data() + limit_str.size(), value);
+      if (ec != std::errc{} || value == 0 || value > 50) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("无效的请求参数"));
+        return;
+      }
+      limit = value;
+    }
+
+    // 多取一些，跳过已经删除或下线的文章
+    auto ids = trending::instance().top(limit * 2);
+    auto list = article_feed::instance().summaries_of(ids, limit);
+    int total = static_cast<int>(list.size());
+    std::string json = make_data(std::move(list), "获取热门文章成功", total);
+    if (json.empty()) {
+      set_server_internel_error(resp);
+      return;
+    }
+    resp.set_status_and_content(status_type::ok, std::move(json));
+  }
+
+  // 批量获取已发布文章的摘要，用于评论、通知等列表显示文章标题
+  void get_articles_batch(coro_http_request &req, coro_http_response &resp) {
+    constexpr size_t max_batch_size = 50;
+    article_batch_request request{};
+    std::error_code ec;
+    iguana::from_json(request, req.get_body(), ec);
+    if (ec) {
+      resp.set_status_and_content(status_type::bad_request,
+                                  make_error("无效的请求参数"));
+      return;
+    }
+    if (request.slugs.size() + request.ids.size() > max_batch_size) {
+      resp.set_status_and_content(
+          status_type::bad_request,
+          make_error("一次最多获取" + std::to_string(max_batch_size) +
+                     "篇文章"));
+      return;
+    }
+
+    // slug从内存索引换成文章ID，按请求顺序去重
+    std::vector<uint64_t> ids;
+    ids.reserve(request.slugs.size() + request.ids.size());
+    for (const auto &slug : request.slugs) {
+      if (auto entry = slug_index::instance().find(slug)) {
+        ids.push_back(entry->article_id);
+      }
+    }
+    ids.insert(ids.end(), request.ids.begin(), request.ids.end());
+    std::unordered_set<uint64_t> seen;
+    std::erase_if(ids, [&](uint64_t id) { return !seen.insert(id).second; });
+
+    // 已发布的文章都在内存列表中，未发布或已删除的文章不返回
+    auto summaries = article_feed::instance().find_all(ids);
+    std::vector<article_batch_item> items;
+    items.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+      if (summaries[i]) {
+        items.push_back(article_batch_item{ids[i], std::move(*summaries[i])});
+      }
+    }
+
+    int total = static_cast<int>(items.size());
+    std::string json = make_data(std::move(items), "批量获取文章成功", total);
+    if (json.empty()) {
       set_server_internel_error(resp);
       return;
     }
+    resp.set_status_and_content(status_type::ok, std::move(json));
+  }
 
-    // 获取注册会员数
-    int user_count = conn->select(ormpp::count()).from<users_t>().collect();
+  // 获取统计数据
+  void get_stats(coro_http_request &req, coro_http_response &resp) {
+    auto &config = purecpp_config::get_instance();
 
-    // 获取技术文章数
+    // 注册会员数和已发布的文章数由site_stats增量维护
+    int user_count = static_cast<int>(site_stats::instance().user_count());
     int article_count =
-        conn->select(ormpp::count()).from<articles_t>().collect();
+        static_cast<int>(site_stats::instance().article_count());
 
     // 参会人数（这里使用模拟数据，实际项目中可能需要从专门的表中获取）
     int conference_attendees = 12000;
@@ -1148,5 +1160,54 @@ public:
     }
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
+
+private:
+  // "社区精华"标签的ID
+  static constexpr int featured_tag_id = 108;
+
+  // 从内存列表获取某个标签组下已发布的文章
+  void get_group_articles(coro_http_request &req, coro_http_response &resp,
+                          TagGroupType group, std::string msg) {
+    // 从请求体中获取分页信息
+    auto body = req.get_body();
+    article_page_request page_req{};
+    std::error_code ec;
+    if (!body.empty()) {
+      iguana::from_json(page_req, body, ec);
+    }
+
+    int page = 1;
+    int per_page = 10;
+
+    if (page_req.current_page > 0) {
+      page = page_req.current_page;
+    }
+    if (page_req.per_page > 0 && page_req.per_page <= 50) {
+      per_page = page_req.per_page;
+    }
+
+    std::optional<feed_key> after;
+    if (!page_req.cursor.empty()) {
+      auto cursor = decode_cursor(page_req.cursor);
+      if (!cursor) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("无效的分页游标"));
+        return;
+      }
+      after = to_feed_key(*cursor);
+    }
+
+    auto result = article_feed::instance().get_page(
+        group, 0, 0, (page - 1) * per_page, per_page,
+        after ? &*after : nullptr);
+    std::string json = make_data(std::move(result.list), std::move(msg),
+                                 result.total_count, next_cursor_of(result));
+    if (json.empty()) {
+      set_server_internel_error(resp);
+      return;
+    }
+
+    resp.set_status_and_content(status_type::ok, std::move(json));
+  }
 };
 } // namespace purecpp
@@ -1,7 +1,9 @@
 #pragma once
 #include "common.hpp"
 #include "entity.hpp"
+#include "request_data.hpp"
 #include <any>
+#include <charconv>
 #include <chrono>
 #include <string_view>
 
@@ -29,9 +31,34 @@ struct check_get_comments {
 
     get_comments_request request;
     request.slug = slug;
-    req.set_user_data(request);
+
+    // 分页参数：?limit=&offset=获取顶层评论，再加上thread=获取回复
+    auto parse = [&](std::string_view name, auto &value) {
+      auto text = req.get_query_value(name);
+      if (text.empty()) {
+        return true;
+      }
+      auto [ptr, ec] =
+          std::from_chars(text.data(), text.data() + text.size(), value);
+      return ec == std::errc{} && ptr == text.data() + text.size();
+    };
+    if (!parse("thread", request.thread_id) ||
+        !parse("offset", request.offset) || !parse("limit", request.limit) ||
+        request.limit > max_page_size) {
+      res.set_status_and_content(status_type::bad_request,
+                                 "invalid page parameters");
+      return false;
+    }
+    if (request.thread_id != 0 && request.limit == 0) {
+      request.limit = default_page_size;
+    }
+
+    set_request_data(req, request);
     return true;
   }
+
+  static constexpr size_t default_page_size = 20;
+  static constexpr size_t max_page_size = 100;
 };
 
 // 合并的添加评论校验切面
@@ -62,7 +89,7 @@ struct check_add_comment {
       return false;
     }
 
-    req.set_user_data(request);
+    set_request_data(req, request);
     return true;
   }
 };
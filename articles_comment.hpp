@@ -1,7 +1,16 @@
 #pragma once
+#include "article_feed.hpp"
 #include "articles_aspects.hpp"
 #include "articles_dto.hpp"
+#include "comment_cache.hpp"
+#include "comment_counter.hpp"
+#include "comment_stream.hpp"
+#include "comment_tree.hpp"
 #include "common.hpp"
+#include "count_cache.hpp"
+#include "detail_cache.hpp"
+#include "slug_index.hpp"
+#include "trending.hpp"
 
 #include <string>
 #include <vector>
@@ -16,72 +25,77 @@ class articles_comment {
 public:
   // 获取文章评论
   void get_article_comment(coro_http_request &req, coro_http_response &resp) {
-    auto request = std::any_cast<get_comments_request>(req.get_user_data());
-
-    auto conn = connection_pool<dbng<mysql>>::instance().get();
-    if (conn == nullptr) {
-      set_server_internel_error(resp);
-      return;
-    }
+    auto request = get_request_data<get_comments_request>(req);
 
     // 获取文章id
-    auto article_vec = conn->select(col(&articles_t::article_id))
-                           .from<articles_t>()
-                           .where(col(&articles_t::slug).param())
-                           .collect(request.slug);
-    if (article_vec.empty()) {
+    auto entry = slug_index::instance().find(request.slug);
+    if (!entry) {
       resp.set_status_and_content(status_type::bad_request,
                                   make_error("评论文章未找到"));
       return;
     }
 
-    uint64_t article_id = std::get<0>(article_vec.front());
+    uint64_t article_id = entry->article_id;
 
-    // 获取评论列表
-    auto comments =
-        conn->select(col(&article_comments_t::comment_id),
-                     col(&article_comments_t::article_id),
-                     col(&article_comments_t::user_id),
-                     col(&users_t::user_name),
-                     col(&article_comments_t::content),
-                     col(&article_comments_t::parent_comment_id),
-                     col(&article_comments_t::parent_user_name),
-                     col(&article_comments_t::ip),
-                     col(&article_comments_t::comment_status),
-                     col(&article_comments_t::created_at),
-                     col(&article_comments_t::updated_at))
-            .from<article_comments_t>()
-            .inner_join(col(&article_comments_t::user_id), col(&users_t::id))
-            .where(col(&article_comments_t::article_id).param())
-            .order_by(col(&article_comments_t::created_at).desc())
-            .collect<get_comments_response>(article_id);
-    // 如果评论没有子评论，那就不显示该评论了。如果评论有子评论，那正常显示该评论，内容修改为：原评论也删除。
-    std::erase_if(comments, [comments](get_comments_response &comment) -> bool {
-      if (comment.comment_status !=
-          static_cast<int32_t>(CommentStatus::DELETED)) {
-        return false;
-      }
-      for (const auto &child_comment : comments) {
-        if (child_comment.comment_id != comment.comment_id &&
-            child_comment.parent_comment_id == comment.comment_id &&
-            child_comment.comment_status ==
-                static_cast<int32_t>(CommentStatus::PUBLISH)) {
-          comment.content = "该评论已被删除";
-          return false;
-        }
+    // 已删除的评论有回复时显示为"该评论已被删除"，否则不显示
+    auto snapshot = comment_cache::instance().get(article_id);
+    if (snapshot == nullptr) {
+      auto version = comment_cache::instance().version(article_id);
+      auto conn = connection_pool<dbng<mysql>>::instance().get();
+      if (conn == nullptr) {
+        set_server_internel_error(resp);
+        return;
       }
-      return true;
-    });
 
-    // 对引用的评论进行用户信息加工
-    std::string json =
-        make_data(comments, std::string("Comments retrieved successfully"));
+      // 获取评论列表
+      auto comments =
+          conn->select(col(&article_comments_t::comment_id),
+                       col(&article_comments_t::article_id),
+                       col(&article_comments_t::user_id),
+                       col(&users_t::user_name),
+                       col(&article_comments_t::content),
+                       col(&article_comments_t::parent_comment_id),
+                       col(&article_comments_t::parent_user_name),
+                       col(&article_comments_t::ip),
+                       col(&article_comments_t::comment_status),
+                       col(&article_comments_t::created_at),
+                       col(&article_comments_t::updated_at))
+              .from<article_comments_t>()
+              .inner_join(col(&article_comments_t::user_id), col(&users_t::id))
+              .where(col(&article_comments_t::article_id).param())
+              .order_by(col(&article_comments_t::created_at).desc())
+              .collect<get_comments_response>(article_id);
+      snapshot = comment_cache::instance().put(article_id, std::move(comments),
+                                               version);
+    }
+
+    const auto &tree = snapshot->tree;
+    std::string json;
+    if (request.thread_id != 0) {
+      size_t total = 0;
+      auto replies = tree.replies(request.thread_id, request.offset,
+                                  request.limit, total);
+      if (!replies) {
+        resp.set_status_and_content(status_type::not_found,
+                                    make_error("评论不存在或已被删除"));
+        return;
+      }
+      json = make_data(std::move(*replies), "获取评论回复成功",
+                       static_cast<int>(total));
+    } else if (request.limit > 0) {
+      json = make_data(
+          tree.threads(request.offset, request.limit, preview_replies),
+          "获取评论成功", static_cast<int>(tree.thread_count()));
+    } else {
+      json = make_data_raw(snapshot->flat_json,
+                           std::string("Comments retrieved successfully"));
+    }
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
 
   // 添加文章评论
   void add_article_comment(coro_http_request &req, coro_http_response &resp) {
-    auto request = std::any_cast<add_comment_request>(req.get_user_data());
+    auto request = get_request_data<add_comment_request>(req);
 
     auto conn = connection_pool<dbng<mysql>>::instance().get();
     if (conn == nullptr) {
@@ -105,16 +119,13 @@ public:
     uint64_t user_id = std::get<0>(user_vec.front());
 
     // 检查文章是否存在
-    auto article_vec = conn->select(col(&articles_t::article_id))
-                           .from<articles_t>()
-                           .where(col(&articles_t::slug).param())
-                           .collect(request.slug);
-    if (article_vec.empty()) {
+    auto entry = slug_index::instance().find(request.slug);
+    if (!entry) {
       resp.set_status_and_content(status_type::bad_request,
                                   make_error("评论文章未找到"));
       return;
     }
-    uint64_t article_id = std::get<0>(article_vec.front());
+    uint64_t article_id = entry->article_id;
 
     // 获取客户端IP地址
     auto client_ip = get_client_ip(req);
@@ -163,24 +174,35 @@ public:
       std::copy_n(parent_user.user_name.begin(), parent_user.user_name.size(),
                   new_comment.parent_user_name.begin());
     }
-    // 插入评论
+    // 插入评论，同一个事务里文章评论数加一
+    conn->begin();
     auto comment_id = conn->get_insert_id_after_insert(new_comment);
-    if (comment_id <= 0) {
+    if (comment_id <= 0 || !comment_counter::add(*conn, article_id, 1)) {
+      conn->rollback();
       set_server_internel_error(resp);
       return;
     }
+    conn->commit();
     new_comment.comment_id = comment_id;
 
-    // 更新文章评论计数
-    auto total_comment =
-        conn->select(count())
-            .from<article_comments_t>()
-            .where(col(&article_comments_t::article_id).param())
-            .collect(article_id);
-    articles_t update_article;
-    update_article.comments_count = total_comment;
-    std::string condition = "article_id=" + std::to_string(article_id);
-    conn->update_some<&articles_t::comments_count>(update_article, condition);
+    article_feed::instance().add_comments(article_id, 1);
+    get_comments_response added{
+        .comment_id = new_comment.comment_id,
+        .article_id = new_comment.article_id,
+        .user_id = new_comment.user_id,
+        .author_name = request.author_name,
+        .content = new_comment.content,
+        .parent_comment_id = new_comment.parent_comment_id,
+        .parent_user_name = new_comment.parent_user_name.data(),
+        .ip = new_comment.ip.data(),
+        .comment_status = static_cast<int32_t>(CommentStatus::PUBLISH),
+        .created_at = new_comment.created_at,
+        .updated_at = new_comment.updated_at};
+    comment_cache::instance().append(article_id, added);
+    comment_stream::instance().publish(article_id, std::move(added));
+    trending::instance().add_comment(article_id);
+    detail_cache::instance().invalidate(request.slug);
+    count_cache::instance().invalidate(count_keys::my_comments(user_id));
     // 返回新评论信息
     add_comment_response response{
         .comment_id = new_comment.comment_id,
@@ -217,6 +239,7 @@ public:
       uint64_t user_id;
       int current_page;
       int per_page;
+      std::string cursor; // 分页游标，不为空时忽略current_page
     };
 
     user_comments_request request;
@@ -263,15 +286,36 @@ public:
     int offset = (current_page - 1) * per_page;
     int limit = per_page;
 
-    // 计算总评论数
-    auto total_count =
-        conn->select(ormpp::count())
-            .from<article_comments_t>()
-            .where(col(&article_comments_t::user_id).param() &&
-                   col(&article_comments_t::comment_status).param())
-            .collect(request.user_id, CommentStatus::PUBLISH);
+    auto where_cond = col(&article_comments_t::user_id).param() &&
+                      col(&article_comments_t::comment_status).param();
+
+    // 计算总评论数，游标分页时不再重复计算
+    count_result total{};
+    if (request.cursor.empty()) {
+      total = count_cache::instance().get(
+          count_keys::my_comments(request.user_id),
+          [&]() -> std::optional<size_t> {
+            size_t count =
+                conn->select(ormpp::count())
+                    .from<article_comments_t>()
+                    .where(where_cond)
+                    .collect(request.user_id, CommentStatus::PUBLISH);
+            return count;
+          });
+    } else {
+      auto cursor = decode_cursor(request.cursor);
+      if (!cursor) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("无效的分页游标"));
+        return;
+      }
+      // 按评论ID排序，ID唯一，从上一页最后一条之后继续不会重复或遗漏
+      where_cond =
+          where_cond && col(&article_comments_t::comment_id) < cursor->id;
+      offset = 0;
+    }
 
-    // 获取用户的评论列表，同时关联文章标题
+    // 获取用户的评论列表，同时关联文章标题，多取一条用于判断是否还有下一页
     auto comments_list =
         conn->select(col(&article_comments_t::comment_id),
                      col(&article_comments_t::article_id),
@@ -283,16 +327,20 @@ public:
             .from<article_comments_t>()
             .inner_join(col(&article_comments_t::article_id),
                         col(&articles_t::article_id))
-            .where(col(&article_comments_t::user_id).param() &&
-                   col(&article_comments_t::comment_status).param())
-            .order_by(col(&article_comments_t::created_at).desc())
+            .where(where_cond)
+            .order_by(col(&article_comments_t::comment_id).desc())
             .limit(ormpp::token)
             .offset(ormpp::token)
             .collect<user_comment_item>(request.user_id, CommentStatus::PUBLISH,
-                                        limit, offset);
+                                        limit + 1, offset);
+    auto next_cursor =
+        take_page(comments_list, limit, [](const user_comment_item &item) {
+          return page_cursor{0, item.created_at, item.comment_id};
+        });
 
-    std::string json = make_data(std::move(comments_list),
-                                 "获取用户评论列表成功", total_count);
+    std::string json =
+        make_data(std::move(comments_list), "获取用户评论列表成功",
+                  total.count, std::move(next_cursor), total.estimated);
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
 
@@ -383,34 +431,117 @@ public:
       return;
     }
 
-    // 删除评论（标记为已删除）
+    // 删除评论（标记为已删除），同一个事务里文章评论数减一
     article_comments_t comment;
     comment.comment_status = CommentStatus::DELETED;
     comment.updated_at = get_timestamp_milliseconds();
 
+    // 只更新仍是已发布状态的评论，并发删除时只减一次
+    conn->begin();
     int n = conn->update_some<&article_comments_t::comment_status,
                               &article_comments_t::updated_at>(
-        comment, "comment_id=" + std::to_string(request.comment_id));
-
+        comment, "comment_id=" + std::to_string(request.comment_id) +
+                     " AND comment_status=" +
+                     std::to_string(
+                         static_cast<int32_t>(CommentStatus::PUBLISH)));
     if (n == 0) {
+      conn->rollback();
+      resp.set_status_and_content(status_type::not_found,
+                                  make_error("评论不存在或已被删除"));
+      return;
+    }
+    if (!comment_counter::add(*conn, article_id, -1)) {
+      conn->rollback();
       set_server_internel_error(resp);
       return;
     }
-
-    // 更新文章评论计数
-    auto total_comment =
-        conn->select(ormpp::count())
-            .from<article_comments_t>()
-            .where(col(&article_comments_t::article_id).param() &&
-                   col(&article_comments_t::comment_status).param())
-            .collect(article_id, CommentStatus::PUBLISH);
-    articles_t update_article;
-    update_article.comments_count = total_comment;
-    std::string condition = "article_id=" + std::to_string(article_id);
-    conn->update_some<&articles_t::comments_count>(update_article, condition);
+    conn->commit();
+
+    article_feed::instance().add_comments(article_id, -1);
+    comment_cache::instance().mark_deleted(article_id, request.comment_id,
+                                           comment.updated_at);
+    count_cache::instance().invalidate(
+        count_keys::my_comments(comment_user_id));
+    auto slugs = conn->select(col(&articles_t::slug))
+                     .from<articles_t>()
+                     .where(col(&articles_t::article_id) == article_id)
+                     .collect();
+    if (!slugs.empty()) {
+      const auto &slug = std::get<0>(slugs.front());
+      detail_cache::instance().invalidate(
+          std::string_view(slug.data(), slug.size()));
+    }
 
     std::string json = make_success("评论删除成功");
     resp.set_status_and_content(status_type::ok, std::move(json));
   }
+
+  /**
+   * @brief 订阅文章的新评论(Server-Sent Events)
+   *
+   * 连接保持打开，发布新评论时唤醒协程把队列中的事件写给客户端，
+   * 空闲时发送心跳。
+   * 客户端读得太慢导致队列溢出时断开连接。只推送订阅之后的新评论，
+   * 断开期间的评论不补发，页面在EventSource重连成功后重新获取评论列表。
+   */
+  async_simple::coro::Lazy<void> subscribe_comments(coro_http_request &req,
+                                                    coro_http_response &resp) {
+    auto it = req.params_.find("slug");
+    if (it == req.params_.end()) {
+      resp.set_status_and_content(status_type::bad_request,
+                                  make_error("无效的请求参数，缺少文章标识符"));
+      co_return;
+    }
+    auto entry = slug_index::instance().find(it->second);
+    if (!entry || entry->is_deleted ||
+        entry->state != article_state::published) {
+      resp.set_status_and_content(status_type::not_found,
+                                  make_error("文章不存在或已被删除"));
+      co_return;
+    }
+
+    uint64_t article_id = entry->article_id;
+    auto conn = resp.get_conn();
+    auto subscriber =
+        comment_stream::instance().subscribe(article_id, conn->get_executor());
+    if (subscriber == nullptr) {
+      resp.set_status_and_content(status_type::service_unavailable,
+                                  make_error("订阅人数过多，请稍后再试"));
+      co_return;
+    }
+
+    // 响应由这里直接写出，框架不再发送
+    resp.set_delay(true);
+    std::string header = "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: text/event-stream\r\n"
+                         "Cache-Control: no-cache\r\n"
+                         "X-Accel-Buffering: no\r\n\r\n"
+                         "retry: 3000\n\n";
+    bool ok = co_await conn->write_data(header);
+    while (ok) {
+      auto frames = subscriber->take();
+      if (subscriber->dropped()) {
+        break;
+      }
+      for (const auto &frame : frames) {
+        if (!(ok = co_await conn->write_data(*frame))) {
+          break;
+        }
+      }
+      // 挂起到发布新评论时唤醒，空闲超过心跳间隔时发送注释保持连接
+      if (ok && !co_await subscriber->wait(stream_heartbeat_interval)) {
+        ok = co_await conn->write_data(":\n\n");
+      }
+    }
+
+    comment_stream::instance().unsubscribe(article_id, subscriber);
+    conn->close();
+  }
+
+private:
+  // 分页获取顶层评论时每条附带的回复数，其余回复按需加载
+  static constexpr size_t preview_replies = 3;
+  // 评论推送空闲时的心跳间隔
+  static constexpr auto stream_heartbeat_interval = std::chrono::seconds(15);
 };
 } // namespace purecpp
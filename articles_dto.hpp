@@ -1,13 +1,30 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace purecpp {
+// 文章列表item
+struct article_list {
+  std::string title;
+  std::string summary;
+  std::string slug;
+  std::string author_name;
+  uint64_t author_id;
+  std::string tag_ids;
+  uint64_t created_at;
+  uint64_t updated_at;
+  uint32_t views_count;
+  uint32_t comments_count;
+  int featured_weight;
+};
+
 // 获取我的文章请求结构体
 struct my_article_request {
   uint64_t user_id = 0; // 0表示所有用户
   int current_page;
   int per_page;
+  std::string cursor; // 分页游标，不为空时忽略current_page
 };
 // 我的文章响应item
 struct my_article_item {
@@ -27,6 +44,9 @@ struct my_article_item {
 // 获取评论请求结构体
 struct get_comments_request {
   std::string slug;
+  uint64_t thread_id = 0; // 不为0时获取该顶层评论下的回复
+  size_t offset = 0;
+  size_t limit = 0; // 为0且没有thread_id时返回全部评论，不分页
 };
 // 查询评论应答
 struct get_comments_response {
@@ -77,6 +97,18 @@ struct user_comment_item {
   uint64_t updated_at;
 };
 
+// 批量获取文章请求，slugs和ids可以同时使用
+struct article_batch_request {
+  std::vector<std::string> slugs;
+  std::vector<uint64_t> ids;
+};
+
+// 批量获取文章应答item
+struct article_batch_item {
+  uint64_t article_id;
+  article_list article;
+};
+
 // 构建统计数据响应
 struct stats_data {
   int user_count;
@@ -0,0 +1,148 @@
+// markdown转纯文本的性能对比：原来的正则实现和现在的单遍扫描
+//
+// 用法：markdown_bench [文章.md ...]
+// 可以传入从数据库导出的文章正文；不传时使用内置的示例文章，
+// 重复拼接到约256KB，模拟一篇带代码块、链接和强调的长文章。
+
+#include "../markdown.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 原user_aspects.hpp中的实现
+std::string legacy_cleanup_markdown(const std::string &markdown_text) {
+  std::string text = markdown_text;
+
+  text = std::regex_replace(text, std::regex("!\\[(.*?)\\]\\(.*?\\)"), "$1");
+  text = std::regex_replace(text, std::regex("\\[(.*?)\\]\\(.*?\\)"), "$1");
+
+  text = std::regex_replace(text, std::regex("(\\*\\*|__)(.*?)\\1"), "$2");
+  text = std::regex_replace(text, std::regex("(\\*|_)(.*?)\\1"), "$2");
+
+  text = std::regex_replace(text, std::regex("```[\\s\\S]*?```"), "");
+  text = std::regex_replace(text, std::regex("`(.*?)`"), "$1");
+
+  text = std::regex_replace(text, std::regex("^#+\\s*"), "");
+
+  text = std::regex_replace(text, std::regex("^[*-+]\\s"), "");
+  text = std::regex_replace(text, std::regex("^>\\s"), "");
+
+  text = std::regex_replace(text, std::regex("\\n+"), " ");
+
+  return text;
+}
+
+constexpr std::string_view sample_article = R"(# C++20协程在网络库中的应用
+
+> 本文介绍如何用**协程**改写基于回调的异步代码。
+
+协程让异步代码可以像同步代码一样书写，[cinatra](https://github.com/qicosmos/cinatra)
+和[async_simple](https://github.com/alibaba/async_simple)都提供了`Lazy<T>`。
+一个*典型*的例子是读取HTTP请求体，`co_await`之后直接得到结果，
+不需要把后续逻辑写在回调里。注意`int* p`和`2*3`这样的写法不是强调。
+
+## 基本用法
+
+- 使用`async_simple::coro::Lazy<void>`作为返回类型
+- 在函数体中使用`co_await`等待其他协程
+- 用`syncAwait`在同步代码中启动协程
+
+```cpp
+async_simple::coro::Lazy<void> handle(coro_http_request &req,
+                                      coro_http_response &resp) {
+  auto body = co_await read_body(req);
+  resp.set_status_and_content(status_type::ok, std::move(body));
+}
+```
+
+![协程状态机](https://example.com/images/coroutine_state_machine.png)
+
+编译器会把协程函数改写成__状态机__，局部变量保存在协程帧中。
+协程帧默认在堆上分配，可以通过自定义`operator new`优化，
+也可以依赖编译器的*HALO*优化消除分配。snake_case_name这样的标识符保持不变。
+
+### 性能对比
+
+| 实现 | QPS |
+| --- | --- |
+| 回调 | 120000 |
+| 协程 | 118000 |
+
+> 协程版本的性能和回调版本相当，但代码量减少了**一半**。
+
+)";
+
+std::string read_file(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+// 返回每轮的耗时(毫秒)，output_bytes为每轮输出的总字节数
+template <typename F>
+double bench(const std::vector<std::string> &articles, int iterations, F fn,
+             size_t &output_bytes) {
+  size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const auto &article : articles) {
+      sink += fn(article).size();
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  output_bytes = sink / iterations;
+  return std::chrono::duration<double, std::milli>(elapsed).count() /
+         iterations;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> articles;
+  for (int i = 1; i < argc; i++) {
+    articles.push_back(read_file(argv[i]));
+  }
+  if (articles.empty()) {
+    std::string article;
+    while (article.size() < 256 * 1024) {
+      article.append(sample_article);
+    }
+    articles.push_back(std::move(article));
+  }
+
+  size_t total_bytes = 0;
+  for (const auto &article : articles) {
+    total_bytes += article.size();
+  }
+  double mb = total_bytes / (1024.0 * 1024.0);
+
+  constexpr int iterations = 20;
+  size_t legacy_bytes = 0, scanner_bytes = 0;
+  double legacy_ms = bench(
+      articles, iterations,
+      [](const std::string &article) {
+        return legacy_cleanup_markdown(article);
+      },
+      legacy_bytes);
+  double scanner_ms = bench(
+      articles, iterations,
+      [](const std::string &article) {
+        return purecpp::cleanup_markdown(article);
+      },
+      scanner_bytes);
+
+  std::printf("%zu articles, %.2f MB\n", articles.size(), mb);
+  std::printf("regex:   %10.3f ms  %8.2f MB/s  %zu bytes out\n", legacy_ms,
+              mb / (legacy_ms / 1000), legacy_bytes);
+  std::printf("scanner: %10.3f ms  %8.2f MB/s  %zu bytes out\n", scanner_ms,
+              mb / (scanner_ms / 1000), scanner_bytes);
+  std::printf("speedup: %.1fx\n", legacy_ms / scanner_ms);
+  return 0;
+}
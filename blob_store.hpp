@@ -0,0 +1,269 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+#include "periodic_task.hpp"
+#include "upload_stream.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace purecpp {
+
+// 上传文件的引用方
+enum class blob_owner : int32_t {
+  article = 1, // 未删除的文章内容
+  avatar = 2,  // 用户头像
+};
+
+/**
+ * @brief 按内容寻址的上传文件存储
+ *
+ * 文件保存为html/uploads/blobs/哈希前两位/哈希.扩展名，内容相同的文件只存一份。
+ * blob_refs表记录文章内容和头像引用了哪些文件，在写文章、删除文章和更换头像的
+ * 同一个事务中重写，不会和内容不一致。后台定期删除在blob_refs中没有引用
+ * 且超过保留期的文件，保留期用于等待刚上传、还没有保存到文章里的文件被引用。
+ */
+class blob_store {
+public:
+  static constexpr std::string_view root_dir = "html/uploads/blobs";
+  static constexpr std::string_view url_prefix = "/uploads/blobs/";
+
+  static blob_store &instance() {
+    static blob_store instance;
+    return instance;
+  }
+
+  /**
+   * @brief 创建写入端，数据写完后调用commit
+   */
+  static upload_sink make_sink(std::string ext, size_t max_size) {
+    return upload_sink(std::filesystem::path(root_dir), std::move(ext),
+                       max_size);
+  }
+
+  /**
+   * @brief blob_refs表为空时根据文章内容和头像回填
+   */
+  bool init() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "blob store init failed: no db connection";
+      return false;
+    }
+
+    auto rows = conn->select(col(&blob_refs_t::id))
+                    .from<blob_refs_t>()
+                    .limit(ormpp::token)
+                    .collect(1);
+    if (!rows.empty()) {
+      return true;
+    }
+
+    std::string pattern = "%" + std::string(url_prefix) + "%";
+    auto articles = conn->query_s<std::tuple<uint64_t, std::string>>(
+        "SELECT article_id, content FROM `articles` WHERE is_deleted = 0 "
+        "AND content LIKE ?",
+        pattern);
+    auto users = conn->query_s<std::tuple<uint64_t, std::string>>(
+        "SELECT id, avatar FROM `users` WHERE avatar LIKE ?", pattern);
+    conn->begin();
+    for (const auto &[article_id, content] : articles) {
+      if (!write_refs(*conn, blob_owner::article, article_id, content)) {
+        conn->rollback();
+        return false;
+      }
+    }
+    for (const auto &[user_id, avatar] : users) {
+      if (!write_refs(*conn, blob_owner::avatar, user_id, avatar)) {
+        conn->rollback();
+        return false;
+      }
+    }
+    conn->commit();
+    CINATRA_LOG_INFO << "blob_refs backfilled for " << articles.size()
+                     << " articles and " << users.size() << " avatars";
+    return true;
+  }
+
+  /**
+   * @brief 保存写完的文件并登记到upload_blobs
+   * @return 出错时返回错误信息，成功返回空
+   */
+  std::string_view commit(upload_sink &sink) {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      return PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED;
+    }
+
+    // 和回收互斥，避免复用的文件在登记前被删除
+    std::lock_guard lock(mutex_);
+    auto err = sink.commit();
+    if (!err.empty()) {
+      return err;
+    }
+
+    upload_blobs_t blob{};
+    std::copy_n(sink.hash().begin(),
+                std::min(sink.hash().size(), blob.hash.size() - 1),
+                blob.hash.begin());
+    std::copy_n(sink.ext().begin(),
+                std::min(sink.ext().size(), blob.ext.size() - 1),
+                blob.ext.begin());
+    blob.size = sink.size();
+    blob.uploaded_at = get_timestamp_milliseconds();
+
+    auto rows = conn->select(col(&upload_blobs_t::hash))
+                    .from<upload_blobs_t>()
+                    .where(col(&upload_blobs_t::hash).param())
+                    .collect(sink.hash());
+    // 哈希只含十六进制字符
+    int n = rows.empty() ? conn->insert(blob)
+                         : conn->update_some<&upload_blobs_t::uploaded_at>(
+                               blob, "hash='" + sink.hash() + "'");
+    if (n != 1) {
+      CINATRA_LOG_ERROR << "register upload blob failed: "
+                        << conn->get_last_error();
+      return PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED;
+    }
+    return {};
+  }
+
+  static std::string url_of(const upload_sink &sink) {
+    return std::string(url_prefix) + sink.name();
+  }
+
+  /**
+   * @brief 文本中引用的所有文件的哈希(已排序、去重)
+   */
+  static std::vector<std::string> blobs_in(std::string_view text) {
+    constexpr size_t hash_size = 64;
+    auto is_hex = [](std::string_view s) {
+      return std::all_of(s.begin(), s.end(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+      });
+    };
+
+    std::vector<std::string> hashes;
+    size_t pos = 0;
+    while ((pos = text.find(url_prefix, pos)) != std::string_view::npos) {
+      pos += url_prefix.size();
+      // 哈希前两位/哈希
+      auto rest = text.substr(pos);
+      if (rest.size() < 3 + hash_size || rest[2] != '/') {
+        continue;
+      }
+      auto hash = rest.substr(3, hash_size);
+      if (rest.substr(0, 2) == hash.substr(0, 2) && is_hex(hash)) {
+        hashes.emplace_back(hash);
+      }
+    }
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+  }
+
+  /**
+   * @brief 重写一个引用方引用的文件，在调用方写内容的事务中执行，
+   * 和内容一起提交或回滚
+   * @param text 引用方的内容，删除文章时为空
+   */
+  static bool write_refs(dbng<mysql> &conn, blob_owner owner,
+                         uint64_t owner_id, std::string_view text) {
+    auto type = static_cast<int32_t>(owner);
+    if (!conn.delete_records_s<blob_refs_t>("owner_type = ? AND owner_id = ?",
+                                            type, owner_id)) {
+      CINATRA_LOG_ERROR << "write blob refs failed: " << conn.get_last_error();
+      return false;
+    }
+    for (const auto &hash : blobs_in(text)) {
+      blob_refs_t row{};
+      std::copy_n(hash.begin(), std::min(hash.size(), row.hash.size() - 1),
+                  row.hash.begin());
+      row.owner_type = type;
+      row.owner_id = owner_id;
+      if (conn.insert(row) == 0) {
+        CINATRA_LOG_ERROR << "write blob refs failed: "
+                          << conn.get_last_error();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief 启动后台回收
+   * @param interval_seconds 回收间隔（秒）
+   */
+  void start(int interval_seconds) {
+    if (interval_seconds <= 0) {
+      interval_seconds = 3600;
+    }
+    task_.start(std::chrono::seconds(interval_seconds), [this] { gc(); });
+  }
+
+  void stop() { task_.stop(); }
+
+  /**
+   * @brief 删除没有引用且超过保留期的文件
+   * @return 删除的文件数
+   */
+  size_t gc() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "blob gc failed: no db connection";
+      return 0;
+    }
+
+    uint64_t cutoff = get_timestamp_milliseconds() - retention_ms;
+    std::lock_guard lock(mutex_);
+    auto rows = conn->query_s<std::tuple<std::string, std::string>>(
+        "SELECT b.hash, b.ext FROM `upload_blobs` b WHERE b.uploaded_at < ? "
+        "AND NOT EXISTS (SELECT 1 FROM `blob_refs` r WHERE r.hash = b.hash) "
+        "LIMIT ?",
+        cutoff, max_gc_batch);
+
+    size_t removed = 0;
+    for (const auto &[hash, ext] : rows) {
+      // 在删除语句中再检查一次，期间写入引用的文件不会被删除
+      if (!conn->delete_records_s<upload_blobs_t>(
+              "hash = ? AND uploaded_at < ? AND NOT EXISTS (SELECT 1 FROM "
+              "`blob_refs` r WHERE r.hash = `upload_blobs`.hash)",
+              hash, cutoff)) {
+        CINATRA_LOG_ERROR << "delete upload blob failed: "
+                          << conn->get_last_error();
+        break;
+      }
+      auto deleted = conn->query_s<std::tuple<int64_t>>("SELECT ROW_COUNT()");
+      if (deleted.empty() || std::get<0>(deleted.front()) <= 0) {
+        continue;
+      }
+      std::error_code ec;
+      std::filesystem::remove(std::filesystem::path(root_dir) /
+                                  hash.substr(0, 2) / (hash + ext),
+                              ec);
+      removed++;
+    }
+    if (removed > 0) {
+      CINATRA_LOG_INFO << "blob gc removed " << removed << " files";
+    }
+    return removed;
+  }
+
+private:
+  blob_store() = default;
+  blob_store(const blob_store &) = delete;
+  blob_store &operator=(const blob_store &) = delete;
+
+  static constexpr uint64_t retention_ms = 24ull * 3600 * 1000;
+  static constexpr size_t max_gc_batch = 500;
+
+  std::mutex mutex_; // 串行化登记和回收
+  periodic_task task_;
+};
+} // namespace purecpp
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "articles_dto.hpp"
+#include "comment_tree.hpp"
+
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <iguana/json_writer.hpp>
+
+namespace purecpp {
+
+// 一篇文章评论的不可变快照
+struct comment_snapshot {
+  explicit comment_snapshot(std::vector<get_comments_response> all)
+      : comments(std::move(all)), tree(comments) {
+    iguana::to_json(tree.flat(), flat_json);
+  }
+
+  std::vector<get_comments_response> comments; // 全部评论，按创建时间降序
+  comment_tree tree;
+  std::string flat_json; // tree.flat()序列化好的JSON
+};
+
+using comment_snapshot_ptr = std::shared_ptr<const comment_snapshot>;
+
+/**
+ * @brief 文章评论缓存，按文章ID做LRU淘汰
+ *
+ * 第一次读取时从数据库加载全部评论，构建评论树并序列化，之后的读取
+ * 直接使用快照。发表、删除评论时只把修改记到缓存项上，不重新构建；
+ * 下一次读取时把积累的修改一起应用到快照上，重新构建一次评论树，
+ * 不再查询数据库。快照创建后不再修改，读取时复制shared_ptr后即可在锁外使用。
+ * 重新构建在缓存的锁外进行，同一分片的重新构建串行执行，
+ * 并发的读取只有一个重新构建；版本号按文章ID分片，
+ * 一篇文章的修改不影响其他文章的加载写入缓存。
+ */
+class comment_cache {
+public:
+  static comment_cache &instance() {
+    static comment_cache instance;
+    return instance;
+  }
+
+  comment_snapshot_ptr get(uint64_t article_id) {
+    {
+      std::lock_guard lock(mutex_);
+      auto it = map_.find(article_id);
+      if (it == map_.end()) {
+        return nullptr;
+      }
+      lru_.splice(lru_.begin(), lru_, it->second.pos);
+      if (it->second.changes.empty()) {
+        return it->second.value;
+      }
+    }
+    return rebuild(article_id);
+  }
+
+  /**
+   * @brief 读库前获取版本号，put时版本号变化说明期间评论有过修改，不再写入
+   */
+  uint64_t version(uint64_t article_id) const {
+    return stripe_of(article_id).version.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief 用从数据库加载的评论构建快照并写入缓存
+   * @param comments 文章的全部评论，按创建时间降序
+   * @param version 读库前通过version()获取的版本号
+   * @return 构建的快照，版本号变化没有写入缓存时也可以用于本次请求
+   */
+  comment_snapshot_ptr put(uint64_t article_id,
+                           std::vector<get_comments_response> comments,
+                           uint64_t version) {
+    auto snapshot = std::make_shared<const comment_snapshot>(
+        std::move(comments));
+    std::lock_guard lock(mutex_);
+    if (version == this->version(article_id)) {
+      store_locked(article_id, snapshot);
+    }
+    return snapshot;
+  }
+
+  /**
+   * @brief 发表评论后加到缓存的快照中
+   */
+  void append(uint64_t article_id, const get_comments_response &comment) {
+    add_change(article_id, change{comment, 0, 0});
+  }
+
+  /**
+   * @brief 删除评论后修改缓存的快照中对应评论的状态
+   */
+  void mark_deleted(uint64_t article_id, uint64_t comment_id,
+                    uint64_t updated_at) {
+    add_change(article_id, change{std::nullopt, comment_id, updated_at});
+  }
+
+  void invalidate(uint64_t article_id) {
+    std::lock_guard lock(mutex_);
+    stripe_of(article_id).version.fetch_add(1, std::memory_order_release);
+    erase_locked(article_id);
+  }
+
+private:
+  comment_cache() = default;
+  comment_cache(const comment_cache &) = delete;
+  comment_cache &operator=(const comment_cache &) = delete;
+
+  static constexpr size_t max_bytes = 32 * 1024 * 1024;
+  static constexpr size_t max_entries = 2048;
+  static constexpr size_t stripe_count = 64;
+  // 积累的修改超过这个数时直接淘汰，下次读取从数据库加载
+  static constexpr size_t max_changes = 256;
+
+  struct stripe {
+    std::mutex rebuild_mutex; // 串行化同一分片中文章的重新构建
+    std::atomic<uint64_t> version = 0;
+  };
+
+  // 尚未应用到快照上的修改
+  struct change {
+    std::optional<get_comments_response> added; // 新发表的评论
+    uint64_t deleted_id;                        // 被删除的评论ID
+    uint64_t updated_at;
+  };
+
+  struct node {
+    comment_snapshot_ptr value;
+    std::list<uint64_t>::iterator pos;
+    size_t bytes;
+    std::vector<change> changes;
+  };
+
+  // 评论原文和序列化后的JSON各占一份，按JSON大小的两倍估算
+  static size_t bytes_of(const comment_snapshot &snapshot) {
+    return snapshot.flat_json.size() * 2;
+  }
+
+  stripe &stripe_of(uint64_t article_id) const {
+    return stripes_[article_id % stripe_count];
+  }
+
+  void add_change(uint64_t article_id, change c) {
+    std::lock_guard lock(mutex_);
+    stripe_of(article_id).version.fetch_add(1, std::memory_order_release);
+    auto it = map_.find(article_id);
+    if (it == map_.end()) {
+      return;
+    }
+    if (it->second.changes.size() >= max_changes) {
+      erase_locked(article_id);
+      return;
+    }
+    it->second.changes.push_back(std::move(c));
+  }
+
+  // 把积累的修改应用到快照上，重新构建时不持有缓存的锁
+  comment_snapshot_ptr rebuild(uint64_t article_id) {
+    auto &s = stripe_of(article_id);
+    std::lock_guard rebuild_lock(s.rebuild_mutex);
+    comment_snapshot_ptr base;
+    std::vector<change> changes;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = map_.find(article_id);
+      if (it == map_.end()) {
+        return nullptr;
+      }
+      // 等待期间其他读取已经重新构建过
+      if (it->second.changes.empty()) {
+        return it->second.value;
+      }
+      base = it->second.value;
+      changes.swap(it->second.changes);
+    }
+
+    auto comments = base->comments;
+    apply(comments, changes);
+    auto snapshot =
+        std::make_shared<const comment_snapshot>(std::move(comments));
+
+    std::lock_guard lock(mutex_);
+    // 期间被淘汰或被加载的新快照替换时不再写入，新快照是修改后从数据库读的；
+    // 期间新增的修改留在缓存项上，下次读取时再应用
+    auto it = map_.find(article_id);
+    if (it != map_.end() && it->second.value == base) {
+      size_t bytes = bytes_of(*snapshot);
+      if (bytes > max_bytes / 4) {
+        erase_locked(article_id);
+      } else {
+        bytes_ = bytes_ - it->second.bytes + bytes;
+        it->second.bytes = bytes;
+        it->second.value = snapshot;
+        while (bytes_ > max_bytes) {
+          erase_locked(lru_.back());
+        }
+      }
+    }
+    return snapshot;
+  }
+
+  static void apply(std::vector<get_comments_response> &comments,
+                    std::vector<change> &changes) {
+    constexpr auto deleted = static_cast<int32_t>(CommentStatus::DELETED);
+    std::vector<get_comments_response> added;
+    for (auto &c : changes) {
+      if (c.added) {
+        added.push_back(std::move(*c.added));
+        continue;
+      }
+      auto mark = [&](std::vector<get_comments_response> &list) {
+        for (auto &comment : list) {
+          if (comment.comment_id == c.deleted_id) {
+            comment.comment_status = deleted;
+            comment.updated_at = c.updated_at;
+            return true;
+          }
+        }
+        return false;
+      };
+      if (!mark(added)) {
+        mark(comments);
+      }
+    }
+    // 新评论按发表顺序记录，快照按创建时间降序
+    comments.insert(comments.begin(), std::make_move_iterator(added.rbegin()),
+                    std::make_move_iterator(added.rend()));
+  }
+
+  void store_locked(uint64_t article_id, comment_snapshot_ptr snapshot) {
+    size_t bytes = bytes_of(*snapshot);
+    erase_locked(article_id);
+    if (bytes > max_bytes / 4) {
+      return;
+    }
+    lru_.push_front(article_id);
+    map_[article_id] = node{std::move(snapshot), lru_.begin(), bytes};
+    bytes_ += bytes;
+    while (bytes_ > max_bytes || map_.size() > max_entries) {
+      erase_locked(lru_.back());
+    }
+  }
+
+  void erase_locked(uint64_t article_id) {
+    auto it = map_.find(article_id);
+    if (it == map_.end()) {
+      return;
+    }
+    bytes_ -= it->second.bytes;
+    auto pos = it->second.pos;
+    map_.erase(it);
+    lru_.erase(pos);
+  }
+
+  std::mutex mutex_;
+  std::list<uint64_t> lru_; // 最近访问的在前
+  std::unordered_map<uint64_t, node> map_;
+  size_t bytes_ = 0;
+  mutable std::array<stripe, stripe_count> stripes_;
+};
+} // namespace purecpp
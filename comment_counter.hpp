@@ -0,0 +1,140 @@
+#pragma once
+
+#include "article_feed.hpp"
+#include "common.hpp"
+#include "detail_cache.hpp"
+#include "entity.hpp"
+#include "periodic_task.hpp"
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace purecpp {
+
+/**
+ * @brief 文章评论数(已发布的评论)
+ *
+ * 发表和删除评论时在同一个事务里用comments_count = comments_count ± 1更新，
+ * 不再每次COUNT(*)整个评论表，内存中的已发布文章列表同步加减。
+ * 后台定期用评论表对账，修正失败的请求或手工修改数据造成的偏差。
+ */
+class comment_counter {
+public:
+  static comment_counter &instance() {
+    static comment_counter instance;
+    return instance;
+  }
+
+  /**
+   * @brief 增减数据库中的评论数，在调用方的事务中执行
+   * @return 没有更新任何行(文章不存在或评论数会减到0以下)时返回false
+   */
+  static bool add(dbng<mysql> &conn, uint64_t article_id, int delta) {
+    std::string sql =
+        "UPDATE `articles` SET comments_count = comments_count + (" +
+        std::to_string(delta) +
+        ") WHERE article_id = " + std::to_string(article_id);
+    // comments_count是无符号数，不能减到0以下
+    if (delta < 0) {
+      sql.append(" AND comments_count >= ").append(std::to_string(-delta));
+    }
+    if (!conn.execute(sql)) {
+      CINATRA_LOG_ERROR << "update comments count failed: "
+                        << conn.get_last_error();
+      return false;
+    }
+    // execute只返回是否成功，受影响的行数需要单独查询
+    auto rows = conn.query_s<std::tuple<int64_t>>("SELECT ROW_COUNT()");
+    if (rows.empty() || std::get<0>(rows.front()) <= 0) {
+      CINATRA_LOG_WARNING << "update comments count matched no row, article: "
+                          << article_id << ", delta: " << delta;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 启动后台对账
+   * @param interval_seconds 对账间隔（秒）
+   */
+  void start(int interval_seconds) {
+    if (interval_seconds <= 0) {
+      interval_seconds = 600;
+    }
+    task_.start(std::chrono::seconds(interval_seconds),
+                [this] { reconcile(); });
+  }
+
+  void stop() { task_.stop(); }
+
+  /**
+   * @brief 修正和评论表不一致的评论数
+   * @return 修正的文章数
+   */
+  size_t reconcile() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "reconcile comments count failed: no db connection";
+      return 0;
+    }
+
+    std::string published =
+        std::to_string(static_cast<int32_t>(CommentStatus::PUBLISH));
+    auto rows = conn->query_s<std::tuple<uint64_t, std::string>>(
+        "SELECT a.article_id, a.slug FROM `articles` a "
+        "LEFT JOIN (SELECT article_id, COUNT(*) AS n FROM `article_comments` "
+        "WHERE comment_status = " +
+        published +
+        " GROUP BY article_id) c ON c.article_id = a.article_id "
+        "WHERE a.comments_count <> IFNULL(c.n, 0)");
+
+    size_t fixed = 0;
+    for (const auto &[article_id, slug] : rows) {
+      auto id = std::to_string(article_id);
+      std::string select_sql =
+          "SELECT comments_count FROM `articles` WHERE article_id = " + id;
+      // 在一条语句里重新计数，不会覆盖查询之后的增减
+      std::string update_sql =
+          "UPDATE `articles` SET comments_count = (SELECT "
+          "COUNT(*) FROM `article_comments` WHERE article_id = " +
+          id + " AND comment_status = " + published +
+          ") WHERE article_id = " + id;
+      // 锁住文章行，期间发表、删除评论的计数更新会等待，
+      // 重新计数前后的差值就是偏差，内存中的评论数加上差值，
+      // 不会覆盖这期间其他请求对内存评论数的增减
+      conn->begin();
+      auto before = conn->query_s<std::tuple<int64_t>>(select_sql +
+                                                       " FOR UPDATE");
+      bool ok = !before.empty() && conn->execute(update_sql);
+      auto after = ok ? conn->query_s<std::tuple<int64_t>>(select_sql)
+                      : std::vector<std::tuple<int64_t>>{};
+      if (after.empty()) {
+        CINATRA_LOG_ERROR << "reconcile comments count failed: "
+                          << conn->get_last_error();
+        conn->rollback();
+        break;
+      }
+      conn->commit();
+
+      int64_t delta = std::get<0>(after.front()) - std::get<0>(before.front());
+      article_feed::instance().add_comments(article_id,
+                                            static_cast<int>(delta));
+      detail_cache::instance().invalidate(slug);
+      fixed++;
+    }
+    if (fixed > 0) {
+      CINATRA_LOG_INFO << "comments count reconciled for " << fixed
+                       << " articles";
+    }
+    return fixed;
+  }
+
+private:
+  comment_counter() = default;
+  comment_counter(const comment_counter &) = delete;
+  comment_counter &operator=(const comment_counter &) = delete;
+
+  periodic_task task_;
+};
+} // namespace purecpp
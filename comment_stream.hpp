@@ -0,0 +1,191 @@
+#pragma once
+
+#include "articles_dto.hpp"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cinatra.hpp>
+#include <iguana/json_writer.hpp>
+
+namespace purecpp {
+
+// 编码好的SSE事件，所有订阅者共享同一份
+using sse_frame = std::shared_ptr<const std::string>;
+
+/**
+ * @brief 一个订阅连接的待发送队列
+ *
+ * 发布时只把共享的事件放进队列，并投递到连接的executor上唤醒等待的协程，
+ * 由连接自己的协程写出。没有新事件时协程挂起在定时器上。
+ * 队列满说明客户端读得太慢，标记为丢弃，由连接关闭，不影响其他订阅者。
+ */
+class comment_subscriber
+    : public std::enable_shared_from_this<comment_subscriber> {
+public:
+  static constexpr size_t max_pending = 32;
+
+  explicit comment_subscriber(coro_io::ExecutorWrapper<> *executor)
+      : timer_(executor) {}
+
+  /**
+   * @return 队列已满时返回false，订阅者被丢弃
+   */
+  bool push(const sse_frame &frame) {
+    bool ok = true;
+    {
+      std::lock_guard lock(mutex_);
+      if (dropped_) {
+        return false;
+      }
+      if (pending_.size() >= max_pending) {
+        dropped_ = true;
+        pending_.clear();
+        ok = false;
+      } else {
+        pending_.push_back(frame);
+      }
+    }
+    wake();
+    return ok;
+  }
+
+  /**
+   * @brief 取出待发送的事件，只能在连接的executor上调用
+   */
+  std::vector<sse_frame> take() {
+    woken_ = false;
+    std::lock_guard lock(mutex_);
+    std::vector<sse_frame> frames(pending_.begin(), pending_.end());
+    pending_.clear();
+    return frames;
+  }
+
+  /**
+   * @brief 等待新事件，只能在连接的executor上调用
+   * @return 有新事件时返回true，超时返回false
+   */
+  async_simple::coro::Lazy<bool> wait(std::chrono::milliseconds timeout) {
+    if (!woken_) {
+      timer_.expires_after(timeout);
+      co_await timer_.async_await();
+    }
+    co_return woken_;
+  }
+
+  bool dropped() {
+    std::lock_guard lock(mutex_);
+    return dropped_;
+  }
+
+private:
+  // 在连接的executor上设置唤醒标记并取消定时器；协程正在写数据时
+  // 取消不起作用，下次等待前检查标记，不会漏掉事件
+  void wake() {
+    asio::post(timer_.get_executor(), [self = shared_from_this()] {
+      self->woken_ = true;
+      self->timer_.cancel();
+    });
+  }
+
+  std::mutex mutex_;
+  std::deque<sse_frame> pending_;
+  bool dropped_ = false;
+  coro_io::period_timer timer_;
+  bool woken_ = false; // 只在连接的executor上访问
+};
+
+/**
+ * @brief 按文章推送新评论(Server-Sent Events)
+ *
+ * 阅读文章的客户端订阅文章的评论流，发表评论时把评论序列化成一个SSE事件，
+ * 所有订阅者共享这一份内容，只增加引用计数，不再逐个序列化。
+ */
+class comment_stream {
+public:
+  static constexpr size_t max_subscribers = 10000;
+
+  static comment_stream &instance() {
+    static comment_stream instance;
+    return instance;
+  }
+
+  /**
+   * @brief 订阅文章的新评论，订阅数达到上限时返回nullptr
+   * @param executor 订阅连接的executor，新事件在上面唤醒连接的协程
+   */
+  std::shared_ptr<comment_subscriber>
+  subscribe(uint64_t article_id, coro_io::ExecutorWrapper<> *executor) {
+    std::lock_guard lock(mutex_);
+    if (count_ >= max_subscribers) {
+      return nullptr;
+    }
+    auto subscriber = std::make_shared<comment_subscriber>(executor);
+    subscribers_[article_id].push_back(subscriber);
+    count_++;
+    return subscriber;
+  }
+
+  void unsubscribe(uint64_t article_id,
+                   const std::shared_ptr<comment_subscriber> &subscriber) {
+    std::lock_guard lock(mutex_);
+    auto it = subscribers_.find(article_id);
+    if (it == subscribers_.end()) {
+      return;
+    }
+    auto &list = it->second;
+    if (std::erase(list, subscriber) > 0) {
+      count_--;
+    }
+    if (list.empty()) {
+      subscribers_.erase(it);
+    }
+  }
+
+  /**
+   * @brief 把新评论推送给文章的所有订阅者
+   */
+  void publish(uint64_t article_id, get_comments_response comment) {
+    std::vector<std::shared_ptr<comment_subscriber>> targets;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = subscribers_.find(article_id);
+      if (it == subscribers_.end()) {
+        return;
+      }
+      targets = it->second;
+    }
+
+    // 推送给所有读者，不带评论者IP
+    comment.ip.clear();
+    std::string json;
+    iguana::to_json(comment, json);
+    auto frame = std::make_shared<std::string>();
+    frame->append("event: comment\nid: ")
+        .append(std::to_string(comment.comment_id))
+        .append("\ndata: ")
+        .append(json)
+        .append("\n\n");
+
+    sse_frame shared = std::move(frame);
+    for (const auto &subscriber : targets) {
+      subscriber->push(shared);
+    }
+  }
+
+private:
+  comment_stream() = default;
+  comment_stream(const comment_stream &) = delete;
+  comment_stream &operator=(const comment_stream &) = delete;
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, std::vector<std::shared_ptr<comment_subscriber>>>
+      subscribers_; // article_id -> 订阅者
+  size_t count_ = 0;
+};
+} // namespace purecpp
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "articles_dto.hpp"
+#include "entity.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace purecpp {
+
+// 一条顶层评论及其回复的前几条
+struct comment_thread {
+  get_comments_response comment;
+  uint32_t reply_count; // 回复总数(包括回复的回复)
+  std::vector<get_comments_response> replies; // 最早的几条回复
+};
+
+/**
+ * @brief 一篇文章的评论树
+ *
+ * 构造时一次遍历统计每条评论已发布的直接回复数，决定已删除评论的去留：
+ * 有已发布回复的保留并显示为"该评论已被删除"，否则不显示。
+ * 再沿父评论找到每条评论所属的顶层评论(带记忆，整体O(n))，
+ * 按顶层评论分组，支持分页获取顶层评论和按需加载某条评论下的回复。
+ * 构造后不再修改，可以在多个线程间共享。
+ */
+class comment_tree {
+public:
+  /**
+   * @param comments 文章的全部评论，按创建时间降序
+   */
+  explicit comment_tree(std::vector<get_comments_response> comments)
+      : comments_(std::move(comments)) {
+    constexpr auto published = static_cast<int32_t>(CommentStatus::PUBLISH);
+    constexpr auto deleted = static_cast<int32_t>(CommentStatus::DELETED);
+
+    std::unordered_map<uint64_t, uint32_t> published_replies;
+    for (const auto &comment : comments_) {
+      if (comment.comment_status == published &&
+          comment.parent_comment_id != 0 &&
+          comment.parent_comment_id != comment.comment_id) {
+        published_replies[comment.parent_comment_id]++;
+      }
+    }
+    std::erase_if(comments_, [&](get_comments_response &comment) {
+      if (comment.comment_status != deleted) {
+        return false;
+      }
+      if (published_replies.contains(comment.comment_id)) {
+        comment.content = "该评论已被删除";
+        return false;
+      }
+      return true;
+    });
+
+    std::unordered_map<uint64_t, size_t> index;
+    index.reserve(comments_.size());
+    for (size_t i = 0; i < comments_.size(); i++) {
+      index.emplace(comments_[i].comment_id, i);
+    }
+
+    // 父评论不存在(已被移除)的评论作为顶层评论
+    constexpr size_t unknown = static_cast<size_t>(-1);
+    std::vector<size_t> root(comments_.size(), unknown);
+    std::vector<size_t> path;
+    for (size_t i = 0; i < comments_.size(); i++) {
+      size_t cur = i;
+      while (root[cur] == unknown) {
+        path.push_back(cur);
+        auto parent = index.find(comments_[cur].parent_comment_id);
+        // path超过评论数说明有环，当作顶层评论
+        if (parent == index.end() || parent->second == cur ||
+            path.size() > comments_.size()) {
+          root[cur] = cur;
+          break;
+        }
+        cur = parent->second;
+      }
+      for (size_t p : path) {
+        root[p] = root[cur];
+      }
+      path.clear();
+    }
+
+    for (size_t i = 0; i < comments_.size(); i++) {
+      if (root[i] == i) {
+        roots_.push_back(i);
+        replies_[comments_[i].comment_id];
+      }
+    }
+    // 回复按创建时间升序
+    for (size_t i = comments_.size(); i-- > 0;) {
+      if (root[i] != i) {
+        replies_[comments_[root[i]].comment_id].push_back(i);
+      }
+    }
+  }
+
+  /**
+   * @brief 所有评论(已处理删除的评论)，按创建时间降序
+   */
+  const std::vector<get_comments_response> &flat() const { return comments_; }
+
+  size_t thread_count() const { return roots_.size(); }
+
+  /**
+   * @brief 一页顶层评论
+   * @param preview 每条顶层评论附带的回复数
+   */
+  std::vector<comment_thread> threads(size_t offset, size_t limit,
+                                      size_t preview) const {
+    std::vector<comment_thread> page;
+    for (size_t i = offset; i < roots_.size() && page.size() < limit; i++) {
+      const auto &comment = comments_[roots_[i]];
+      const auto &replies = replies_.at(comment.comment_id);
+      comment_thread thread{comment, static_cast<uint32_t>(replies.size()),
+                            {}};
+      for (size_t j = 0; j < replies.size() && j < preview; j++) {
+        thread.replies.push_back(comments_[replies[j]]);
+      }
+      page.push_back(std::move(thread));
+    }
+    return page;
+  }
+
+  /**
+   * @brief 一条顶层评论下的一页回复，按创建时间升序
+   * @param total 回复总数
+   * @return 顶层评论不存在时返回std::nullopt
+   */
+  std::optional<std::vector<get_comments_response>>
+  replies(uint64_t thread_id, size_t offset, size_t limit,
+          size_t &total) const {
+    auto it = replies_.find(thread_id);
+    if (it == replies_.end()) {
+      return std::nullopt;
+    }
+
+    std::vector<get_comments_response> page;
+    total = it->second.size();
+    for (size_t i = offset; i < it->second.size() && page.size() < limit;
+         i++) {
+      page.push_back(comments_[it->second[i]]);
+    }
+    return page;
+  }
+
+private:
+  std::vector<get_comments_response> comments_; // 按创建时间降序
+  std::vector<size_t> roots_; // 顶层评论的下标，按创建时间降序
+  // 顶层评论ID -> 回复的下标，按创建时间升序，没有回复的顶层评论对应空列表
+  std::unordered_map<uint64_t, std::vector<size_t>> replies_;
+};
+} // namespace purecpp
@@ -71,7 +71,10 @@ inline std::string make_error(std::string_view err_msg, int code = 400) {
 }
 
 template <typename T>
-inline std::string make_data(T t, std::string msg = "", int total_count = 0) {
+inline std::string
+make_data(T t, std::string msg = "", int total_count = 0,
+          std::optional<std::string> next_cursor = std::nullopt,
+          bool total_estimated = false) {
   rest_response<T> data{};
   data.success = true;
   data.message = std::move(msg);
@@ -80,6 +83,8 @@ inline std::string make_data(T t, std::string msg = "", int total_count = 0) {
   auto now = get_timestamp_milliseconds();
   data.timestamp = std::to_string(now);
   data.total_count = total_count;
+  data.next_cursor = std::move(next_cursor);
+  data.total_estimated = total_estimated;
 
   std::string json;
   try {
@@ -92,6 +97,25 @@ inline std::string make_data(T t, std::string msg = "", int total_count = 0) {
   return json;
 }
 
+/**
+ * @brief 用已经序列化好的JSON作为data生成响应，避免重复序列化
+ * @param raw_json data字段的JSON
+ * @param msg 成功消息
+ */
+inline std::string make_data_raw(std::string_view raw_json,
+                                 std::string msg = "", int total_count = 0) {
+  // data是rest_response的最后一个字段，先用占位值序列化，再替换成raw_json
+  std::string json = make_data(0, std::move(msg), total_count);
+  constexpr std::string_view placeholder = "0}";
+  if (json.size() < placeholder.size() || !json.ends_with(placeholder)) {
+    return "";
+  }
+  json.resize(json.size() - placeholder.size());
+  json.reserve(json.size() + raw_json.size() + 1);
+  json.append(raw_json).append("}");
+  return json;
+}
+
 inline void set_server_internel_error(auto &resp) {
   resp.set_status_and_content(
       status_type::internal_server_error,
@@ -68,6 +68,20 @@ struct user_config {
   std::string web_server_url;     // 网页服务器URL
   std::string default_avatar_url; // 默认头像URL
   int default_user_count = 0;     // 默认用户数
+  // 浏览量写回数据库的间隔（秒）
+  int view_flush_interval_seconds = 10;
+  // 站点统计和数据库对账的间隔（秒）
+  int stats_reconcile_interval_seconds = 300;
+  // 标签目录重新加载的间隔（秒）
+  int tag_reload_interval_seconds = 60;
+  // 回收没有引用的上传文件的间隔（秒）
+  int blob_gc_interval_seconds = 3600;
+  // 接口响应超过该大小时压缩（字节），0表示不压缩
+  size_t compress_min_bytes = 1024;
+  // 热门文章分数的半衰期（小时）
+  int trending_half_life_hours = 24;
+  // 文章评论数和评论表对账的间隔（秒）
+  int comment_reconcile_interval_seconds = 600;
   // 基于路由的限流配置
   std::vector<rate_limit_rule> rate_limit_rules; // 限流规则列表
 
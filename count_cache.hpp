@@ -0,0 +1,185 @@
+#pragma once
+
+#include "periodic_task.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace purecpp {
+
+// 分页列表总数的缓存键，由列表名和过滤条件组成
+namespace count_keys {
+inline std::string pending_articles() { return "pending_articles"; }
+
+inline std::string my_articles(uint64_t author_id) {
+  return "my_articles|author=" + std::to_string(author_id);
+}
+
+inline std::string my_comments(uint64_t user_id) {
+  return "my_comments|user=" + std::to_string(user_id);
+}
+
+inline std::string experience(uint64_t user_id) {
+  return "experience|user=" + std::to_string(user_id);
+}
+} // namespace count_keys
+
+struct count_result {
+  size_t count = 0;
+  bool estimated = false; // 缓存已失效，返回的是失效前的值
+};
+
+/**
+ * @brief 分页列表总数的缓存
+ *
+ * 列表页的COUNT(*)和分页查询条件相同，数据没变时结果也不变。
+ * 按过滤条件缓存总数，数据变化时由对应的写操作调用invalidate。
+ * 过滤条件选择性差、COUNT代价高的列表可以在后台重新计算，
+ * 失效后先返回旧值并标记为估算值，不阻塞当前请求。
+ * 条目数超过上限时按LRU淘汰，计算期间发生的失效不会因淘汰而丢失。
+ */
+class count_cache {
+public:
+  using count_function = std::function<std::optional<size_t>()>;
+
+  static count_cache &instance() {
+    static count_cache instance;
+    return instance;
+  }
+
+  void start() {
+    task_.start(std::chrono::seconds(1), [this] { run_background(); });
+  }
+
+  void stop() { task_.stop(); }
+
+  /**
+   * @brief 获取总数，缓存有效时直接返回
+   * @param key 缓存键，见count_keys
+   * @param compute 查询数据库得到总数，失败时返回std::nullopt
+   * @param background 缓存失效且有旧值时是否在后台重新计算
+   */
+  count_result get(const std::string &key, count_function compute,
+                   bool background = false) {
+    uint64_t started = 0;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = entries_.find(key);
+      if (it != entries_.end()) {
+        auto &e = it->second;
+        lru_.splice(lru_.begin(), lru_, e.lru_it);
+        if (e.valid) {
+          return {e.count, false};
+        }
+        if (background && e.has_value) {
+          pending_.emplace(key, std::move(compute));
+          return {e.count, true};
+        }
+      }
+      started = clock_;
+    }
+
+    auto count = compute();
+    if (!count) {
+      return {0, true};
+    }
+    store(key, *count, started);
+    return {*count, false};
+  }
+
+  /**
+   * @brief 数据变化后让对应的总数失效
+   */
+  void invalidate(const std::string &key) {
+    std::lock_guard lock(mutex_);
+    uint64_t now = ++clock_;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      it->second.valid = false;
+      it->second.invalidated_at = now;
+    } else {
+      // 不在缓存中的键也可能正在计算，记在键所属的分片上
+      stripes_[stripe_of(key)] = now;
+    }
+  }
+
+private:
+  count_cache() = default;
+  count_cache(const count_cache &) = delete;
+  count_cache &operator=(const count_cache &) = delete;
+
+  static constexpr size_t max_entries = 100000;
+  static constexpr size_t stripe_count = 1024;
+
+  struct entry {
+    size_t count = 0;
+    bool valid = false;
+    bool has_value = false;      // 失效后仍保留旧值
+    uint64_t invalidated_at = 0; // 最近一次失效的时钟
+    std::list<std::string>::iterator lru_it;
+  };
+
+  static size_t stripe_of(const std::string &key) {
+    return std::hash<std::string>{}(key) % stripe_count;
+  }
+
+  // started为开始计算时的时钟，计算期间键失效过的结果不作为有效值
+  void store(const std::string &key, size_t count, uint64_t started) {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      lru_.push_front(key);
+      it = entries_.emplace(key, entry{}).first;
+      it->second.lru_it = lru_.begin();
+      it->second.invalidated_at = stripes_[stripe_of(key)];
+      evict_locked();
+    }
+    auto &e = it->second;
+    e.count = count;
+    e.has_value = true;
+    e.valid = e.invalidated_at <= started;
+  }
+
+  // 按最近最少使用的顺序淘汰，失效时钟并入分片，不会丢失
+  void evict_locked() {
+    while (entries_.size() > max_entries) {
+      auto it = entries_.find(lru_.back());
+      uint64_t &stripe = stripes_[stripe_of(it->first)];
+      stripe = std::max(stripe, it->second.invalidated_at);
+      pending_.erase(it->first);
+      entries_.erase(it);
+      lru_.pop_back();
+    }
+  }
+
+  void run_background() {
+    std::unordered_map<std::string, count_function> jobs;
+    uint64_t started = 0;
+    {
+      std::lock_guard lock(mutex_);
+      jobs.swap(pending_);
+      started = clock_;
+    }
+    for (auto &[key, job] : jobs) {
+      if (auto count = job()) {
+        store(key, *count, started);
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  uint64_t clock_ = 0; // 每次invalidate加1
+  std::unordered_map<std::string, entry> entries_;
+  std::list<std::string> lru_; // 最近使用的在前
+  std::array<uint64_t, stripe_count> stripes_{}; // 不在缓存中的键的失效时钟
+  std::unordered_map<std::string, count_function> pending_; // 待后台计算
+  periodic_task task_;
+};
+} // namespace purecpp
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace purecpp {
+
+/**
+ * @brief 文章详情的JSON缓存，按slug做LRU淘汰
+ *
+ * 缓存的是序列化好的article_detail，在views_count的值处切成前后两段，
+ * 命中时拼上最新的浏览量即可返回，不需要查库也不需要重新序列化。
+ * 浏览量 = 写入缓存时数据库中的值 + 缓存期间的浏览次数。
+ * 文章编辑、审核、删除、加精华或评论变化时通过invalidate删除缓存。
+ */
+class detail_cache {
+public:
+  static detail_cache &instance() {
+    static detail_cache instance;
+    return instance;
+  }
+
+  /**
+   * @brief 查询缓存，命中时记一次浏览并返回带最新浏览量的JSON
+   */
+  std::optional<std::string> hit(std::string_view slug) {
+    std::shared_ptr<entry> e;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = map_.find(std::string(slug));
+      if (it == map_.end()) {
+        return std::nullopt;
+      }
+      lru_.splice(lru_.begin(), lru_, it->second.pos);
+      e = it->second.value;
+    }
+
+    uint32_t views =
+        e->base_views + e->views.fetch_add(1, std::memory_order_relaxed) + 1;
+    std::string json;
+    auto views_str = std::to_string(views);
+    json.reserve(e->head.size() + views_str.size() + e->tail.size());
+    json.append(e->head).append(views_str).append(e->tail);
+    return json;
+  }
+
+  /**
+   * @brief 读库前获取版本号，put时版本号变化说明期间有过失效，不再写入
+   */
+  uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief 写入缓存
+   * @param json 序列化好的article_detail
+   * @param views json中的浏览量
+   * @param version 读库前通过version()获取的版本号
+   */
+  void put(std::string_view slug, std::string_view json, uint32_t views,
+           uint64_t version) {
+    constexpr std::string_view key = "\"views_count\":";
+    auto pos = json.rfind(key);
+    if (pos == std::string_view::npos) {
+      return;
+    }
+    auto value_begin = pos + key.size();
+    auto value_end = json.find_first_not_of("0123456789", value_begin);
+    if (value_end == std::string_view::npos) {
+      return;
+    }
+
+    auto e = std::make_shared<entry>();
+    e->head = json.substr(0, value_begin);
+    e->tail = json.substr(value_end);
+    e->base_views = views;
+    size_t bytes = e->head.size() + e->tail.size();
+    if (bytes > max_bytes / 4) {
+      return;
+    }
+
+    std::lock_guard lock(mutex_);
+    if (version != version_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    erase_locked(std::string(slug));
+    lru_.push_front(std::string(slug));
+    map_[lru_.front()] = node{e, lru_.begin(), bytes};
+    bytes_ += bytes;
+    while (bytes_ > max_bytes || map_.size() > max_entries) {
+      erase_locked(lru_.back());
+    }
+  }
+
+  /**
+   * @brief 删除单篇文章的缓存
+   */
+  void invalidate(std::string_view slug) {
+    std::lock_guard lock(mutex_);
+    version_.fetch_add(1, std::memory_order_release);
+    erase_locked(std::string(slug));
+  }
+
+private:
+  detail_cache() = default;
+  detail_cache(const detail_cache &) = delete;
+  detail_cache &operator=(const detail_cache &) = delete;
+
+  static constexpr size_t max_bytes = 64 * 1024 * 1024;
+  static constexpr size_t max_entries = 4096;
+
+  struct entry {
+    std::string head; // views_count的值之前的部分
+    std::string tail; // views_count的值之后的部分
+    uint32_t base_views = 0;
+    std::atomic<uint32_t> views = 0; // 缓存期间的浏览次数
+  };
+
+  struct node {
+    std::shared_ptr<entry> value;
+    std::list<std::string>::iterator pos;
+    size_t bytes;
+  };
+
+  void erase_locked(const std::string &slug) {
+    auto it = map_.find(slug);
+    if (it == map_.end()) {
+      return;
+    }
+    bytes_ -= it->second.bytes;
+    auto pos = it->second.pos;
+    map_.erase(it);
+    lru_.erase(pos);
+  }
+
+  std::mutex mutex_;
+  std::list<std::string> lru_; // 最近访问的在前
+  std::unordered_map<std::string, node> map_;
+  size_t bytes_ = 0;
+  std::atomic<uint64_t> version_ = 0;
+};
+} // namespace purecpp
@@ -172,6 +172,40 @@ constexpr std::string_view get_alias_struct_name(articles_t *) {
   return "articles";
 }
 
+// 文章和标签的关联表，由articles_t::tag_ids同步维护
+struct article_tags_t {
+  uint64_t id = 0;
+  uint64_t article_id; // 外键
+  int tag_id;          // 外键
+};
+REGISTER_AUTO_KEY(article_tags_t, id);
+constexpr std::string_view get_alias_struct_name(article_tags_t *) {
+  return "article_tags";
+}
+
+// 上传的文件，按内容的SHA-256去重存储
+struct upload_blobs_t {
+  std::array<char, 65> hash; // SHA-256的十六进制，主键
+  std::array<char, 8> ext;   // 扩展名，带点号
+  uint64_t size;
+  uint64_t uploaded_at; // 最近一次上传的时间
+};
+constexpr std::string_view get_alias_struct_name(upload_blobs_t *) {
+  return "upload_blobs";
+}
+
+// 文章内容和头像对上传文件的引用，一个引用方引用一个文件对应一行
+struct blob_refs_t {
+  uint64_t id = 0;
+  std::array<char, 65> hash; // upload_blobs的主键
+  int32_t owner_type;        // blob_owner
+  uint64_t owner_id;         // 文章ID或用户ID
+};
+REGISTER_AUTO_KEY(blob_refs_t, id);
+constexpr std::string_view get_alias_struct_name(blob_refs_t *) {
+  return "blob_refs";
+}
+
 // 文章评论状态枚举
 enum class CommentStatus : int32_t {
   DELETED = 0, // 已删除
@@ -289,6 +323,8 @@ template <typename T> struct rest_response {
   std::string timestamp;
   int code = 200;
   int total_count = 0; // 总记录数，用于分页
+  bool total_estimated = false; // total_count是否为估算值(缓存刷新中)
+  std::optional<std::string> next_cursor; // 游标分页时的下一页游标
   std::optional<T> data;
 };
 } // namespace purecpp
\ No newline at end of file
@@ -60,6 +60,12 @@ inline constexpr std::string_view PURECPP_ERROR_UPLOAD_FILE_SIZE_EXCEED =
     "上传文件大小不能超过4MB";
 inline constexpr std::string_view PURECPP_ERROR_UPLOAD_FILE_INVALID_CONTENT =
     "上传文件包含危险内容";
+inline constexpr std::string_view PURECPP_ERROR_UPLOAD_FILE_TYPE_MISMATCH =
+    "上传文件内容和扩展名不符";
+inline constexpr std::string_view PURECPP_ERROR_UPLOAD_FILE_READ_FAILED =
+    "读取上传数据失败";
+inline constexpr std::string_view PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED =
+    "保存文件失败";
 
 // 注册相关错误
 inline constexpr std::string_view PURECPP_ERROR_REGISTER_INFO_EMPTY =
@@ -14,12 +14,27 @@
 #include <random>
 #include <vector>
 
+#include "article_feed.hpp"
+#include "article_tags.hpp"
 #include "articles.hpp"
 #include "articles_aspects.hpp"
 #include "articles_comment.hpp"
+#include "blob_store.hpp"
+#include "comment_counter.hpp"
+#include "count_cache.hpp"
 #include "entity.hpp"
+#include "file_response.hpp"
+#include "metrics.hpp"
 #include "rate_limiter.hpp"
+#include "response_compress.hpp"
+#include "search_index.hpp"
+#include "site_feeds.hpp"
+#include "site_stats.hpp"
+#include "slug_index.hpp"
+#include "static_cache.hpp"
+#include "tag_catalog.hpp"
 #include "tags.hpp"
+#include "trending.hpp"
 #include "user_aspects.hpp"
 #include "user_experience.hpp"
 #include "user_experience_aspects.hpp"
@@ -27,6 +42,7 @@
 #include "user_password.hpp"
 #include "user_profile.hpp"
 #include "user_register.hpp"
+#include "view_counter.hpp"
 
 using namespace cinatra;
 using namespace ormpp;
@@ -104,6 +120,14 @@ bool init_db() {
   conn->create_datatable<article_comments_t>(ormpp_auto_key{"comment_id"});
   conn->create_datatable<articles_t>(ormpp_auto_key{"article_id"},
                                      ormpp_unique{{"slug"}});
+  conn->create_datatable<article_tags_t>(
+      ormpp_auto_key{"id"}, ormpp_unique{{"article_id", "tag_id"}},
+      ormpp_not_null{{"article_id", "tag_id"}});
+  conn->create_datatable<upload_blobs_t>(ormpp_key{"hash"});
+  conn->create_datatable<blob_refs_t>(
+      ormpp_auto_key{"id"}, ormpp_unique{{"hash", "owner_type", "owner_id"}},
+      ormpp_unique{{"owner_type", "owner_id", "hash"}},
+      ormpp_not_null{{"hash", "owner_type", "owner_id"}});
 
   // 创建密码重置token表
   bool created = conn->create_datatable<users_token_t>(
@@ -187,60 +211,102 @@ int main() {
   if (!init_db()) {
     return -1;
   }
-  // 从配置文件加载配置
+
+  // 从配置文件加载配置，sitemap和订阅需要其中的网站URL
   purecpp_config::get_instance().load_config("cfg/user_config.json");
 
+  // 加载标签目录和已发布文章列表，文章标签表为空时回填
+  if (!tag_catalog::instance().reload()) {
+    return -1;
+  }
+  if (!article_tag_index::instance().init()) {
+    return -1;
+  }
+  if (!article_feed::instance().init()) {
+    return -1;
+  }
+  if (!slug_index::instance().init()) {
+    return -1;
+  }
+  // 建立文章全文索引
+  if (!search_index::instance().init()) {
+    return -1;
+  }
   // 初始化限流器
   rate_limiter::instance().init_from_config();
 
+  // 启动浏览量定期写回
+  view_counter::instance().start(
+      purecpp_config::get_instance().user_cfg_.view_flush_interval_seconds);
+
+  // 热门文章的分数衰减
+  trending::instance().init(
+      purecpp_config::get_instance().user_cfg_.trending_half_life_hours);
+
+  // 加载站点统计并定期对账
+  if (!site_stats::instance().init()) {
+    return -1;
+  }
+  site_stats::instance().start(
+      purecpp_config::get_instance().user_cfg_.stats_reconcile_interval_seconds);
+
+  // 加载静态文件
+  if (!static_cache::instance().load("html", "uploads")) {
+    return -1;
+  }
+
+  // 分页总数的后台刷新
+  count_cache::instance().start();
+
+  // 定期重新加载标签目录
+  tag_catalog::instance().start(
+      purecpp_config::get_instance().user_cfg_.tag_reload_interval_seconds);
+
+  // 定期修正文章评论数
+  comment_counter::instance().start(
+      purecpp_config::get_instance()
+          .user_cfg_.comment_reconcile_interval_seconds);
+
+  // 合并文章变化后重新生成sitemap和订阅
+  site_feeds::instance().start();
+
+  // 定期回收没有引用的上传文件
+  if (!blob_store::instance().init()) {
+    return -1;
+  }
+  blob_store::instance().start(
+      purecpp_config::get_instance().user_cfg_.blob_gc_interval_seconds);
+
   auto &db_pool = connection_pool<dbng<mysql>>::instance();
 
   coro_http_server server(std::thread::hardware_concurrency(), 443);
   server.init_ssl("purecpp.pem", "purecpp.key");
-  server.set_file_resp_format_type(file_resp_format_type::chunked);
-  server.set_static_res_dir("", "html");
+  // 静态文件从内存缓存返回，上传目录由/uploads路由处理
+  for (const auto &path : static_cache::instance().paths()) {
+    auto route = static_cache::instance().find(path);
+    server.set_http_handler<GET>(
+        path, [route](coro_http_request &req, coro_http_response &resp) {
+          static_cache::serve(*route, req, resp);
+        });
+  }
   server.set_http_handler<GET, POST>(
-      "/",
-      [](coro_http_request &req,
-         coro_http_response &resp) -> async_simple::coro::Lazy<void> {
-        auto url = req.get_url();
-        std::string file_name = "html/index.html";
-        coro_io::coro_file in_file{};
-        if (!in_file.open(file_name, std::ios::in)) {
+      "/", [](coro_http_request &req, coro_http_response &resp) {
+        auto route = static_cache::instance().find("/index.html");
+        if (route == nullptr) {
           resp.set_status(status_type::not_found);
-          co_return;
+          return;
         }
-        std::string_view extension = get_extension(file_name);
-        std::string_view mime = get_mime_type(extension);
-        resp.add_header("Content-Type", std::string{mime});
-        resp.set_format_type(format_type::chunked);
+        static_cache::serve(*route, req, resp);
+      });
 
-        // 开始chunked传输
-        if (!co_await resp.get_conn()->begin_chunked()) {
-          co_return;
-        }
-        std::string content;
-        cinatra::detail::resize(content, in_file.file_size());
-        while (true) {
-          auto [ec, size] =
-              co_await in_file.async_read(content.data(), content.size());
-          if (ec) {
-            resp.set_status(status_type::no_content);
-            co_await resp.get_conn()->reply();
-            co_return;
-          }
-
-          bool r = co_await resp.get_conn()->write_chunked(
-              std::string_view(content.data(), size));
-          if (!r) {
-            co_return;
-          }
-
-          if (in_file.eof()) {
-            co_await resp.get_conn()->end_chunked();
-            break;
-          }
-        }
+  // 爬虫和订阅器使用，内容在文章变化时预先生成
+  server.set_http_handler<GET>(
+      "/sitemap.xml", [](coro_http_request &req, coro_http_response &resp) {
+        static_cache::serve_copy(site_feeds::instance().sitemap(), req, resp);
+      });
+  server.set_http_handler<GET>(
+      "/feed.atom", [](coro_http_request &req, coro_http_response &resp) {
+        static_cache::serve_copy(site_feeds::instance().atom(), req, resp);
       });
 
   server.set_http_handler<GET>(
@@ -307,23 +373,28 @@ int main() {
       check_reset_password{});
   tags tag{};
   server.set_http_handler<GET>("/api/v1/get_tags", &tags::get_tags, tag,
-                               log_request_response{});
+                               log_request_response{}, compress_response{});
+  server.set_http_handler<POST>("/api/v1/reload_tags", &tags::reload_tags, tag,
+                                log_request_response{}, check_token{});
 
   articles article{};
   server.set_http_handler<POST>(
       "/api/v1/new_article", &articles::handle_new_article, article,
       log_request_response{}, check_token{}, experience_reward_aspect{});
   server.set_http_handler<POST>("/api/v1/get_articles", &articles::get_articles,
-                                article, log_request_response{});
+                                article, log_request_response{},
+                                compress_response{});
 
   server.set_http_handler<GET>("/api/v1/article/:slug", &articles::show_article,
-                               article, log_request_response{});
+                               article, log_request_response{},
+                               compress_response{});
   server.set_http_handler<POST>("/api/v1/edit_article", &articles::edit_article,
                                 article, log_request_response{}, check_token{},
                                 check_edit_article{});
   server.set_http_handler<POST>("/api/v1/get_pending_articles",
                                 &articles::get_pending_articles, article,
-                                log_request_response{}, check_token{});
+                                log_request_response{}, check_token{},
+                                compress_response{});
   server.set_http_handler<POST>("/api/v1/review_pending_article",
                                 &articles::handle_review_article, article,
                                 log_request_response{}, check_token{});
@@ -335,7 +406,11 @@ int main() {
   articles_comment comment{};
   server.set_http_handler<GET>("/api/v1/get_article_comment/:slug",
                                &articles_comment::get_article_comment, comment,
-                               log_request_response{}, check_get_comments{});
+                               log_request_response{}, check_get_comments{},
+                               compress_response{});
+  server.set_http_handler<GET>("/api/v1/comments/stream/:slug",
+                               &articles_comment::subscribe_comments, comment,
+                               log_request_response{});
   server.set_http_handler<POST>(
       "/api/v1/add_article_comment", &articles_comment::add_article_comment,
       comment, log_request_response{}, check_token{}, check_add_comment{},
@@ -379,55 +454,28 @@ int main() {
       [](coro_http_request &req,
          coro_http_response &resp) -> async_simple::coro::Lazy<void> {
         auto url = req.get_url();
-        std::string file_name;
-        file_name.append("html/").append(url);
-        coro_io::coro_file in_file{};
-        if (!in_file.open(file_name, std::ios::in)) {
+        if (url.find("..") != std::string_view::npos) {
           resp.set_status(status_type::not_found);
           co_return;
         }
-        std::string_view extension = get_extension(file_name);
-        std::string_view mime = get_mime_type(extension);
-        resp.add_header("Content-Type", std::string{mime});
-        resp.set_format_type(format_type::chunked);
-
-        // 开始chunked传输
-        if (!co_await resp.get_conn()->begin_chunked()) {
-          co_return;
-        }
-        std::string content;
-        cinatra::detail::resize(content, 10240);
-        while (true) {
-          auto [ec, size] =
-              co_await in_file.async_read(content.data(), content.size());
-          if (ec) {
-            resp.set_status(status_type::no_content);
-            co_await resp.get_conn()->reply();
-            co_return;
-          }
-
-          bool r = co_await resp.get_conn()->write_chunked(
-              std::string_view(content.data(), size));
-          if (!r) {
-            co_return;
-          }
-
-          if (in_file.eof()) {
-            co_await resp.get_conn()->end_chunked();
-            break;
-          }
-        }
+        std::string file_name;
+        file_name.append("html/").append(url);
+        // 上传的文件不会被修改(重新上传会生成新的URL)，允许浏览器长期缓存
+        co_await send_file(req, resp, file_name,
+                           "public, max-age=31536000, immutable");
       });
 
   // 用户文章相关路由
   server.set_http_handler<POST>("/api/v1/get_myarticles",
                                 &articles::get_my_articles, article,
-                                log_request_response{}, check_token{});
+                                log_request_response{}, check_token{},
+                                compress_response{});
 
   // 用户评论相关路由
   server.set_http_handler<POST>("/api/v1/get_mycomments",
                                 &articles_comment::get_my_comments, comment,
-                                log_request_response{}, check_token{});
+                                log_request_response{}, check_token{},
+                                compress_response{});
 
   // 删除文章路由
   server.set_http_handler<POST>("/api/v1/delete_myarticle",
@@ -442,20 +490,61 @@ int main() {
   // 获取社区服务文章路由
   server.set_http_handler<POST>("/api/v1/get_community_service_articles",
                                 &articles::get_community_service, article,
-                                log_request_response{});
+                                log_request_response{}, compress_response{});
 
   // 获取purecpp大会文章路由
   server.set_http_handler<POST>("/api/v1/get_purecpp_conference_articles",
                                 &articles::get_purecpp_conference, article,
-                                log_request_response{});
+                                log_request_response{}, compress_response{});
 
   // 文章加精华/取消精华路由
   server.set_http_handler<POST>("/api/v1/toggle_featured",
                                 &articles::toggle_featured, article,
                                 log_request_response{}, check_token{});
 
+  // 批量获取文章摘要路由
+  server.set_http_handler<POST>("/api/v1/articles/batch",
+                                &articles::get_articles_batch, article,
+                                log_request_response{}, compress_response{});
+
+  // 热门文章路由
+  server.set_http_handler<GET>("/api/v1/get_trending_articles",
+                               &articles::get_trending_articles, article,
+                               log_request_response{});
+
   // 获取统计数据路由
   server.set_http_handler<GET>("/api/v1/stats", &articles::get_stats, article,
                                log_request_response{});
+
+  // 接口响应压缩统计，需要管理员登录
+  metrics metric{};
+  server.set_http_handler<GET>("/api/v1/metrics/compression",
+                               &metrics::get_compression_metrics, metric,
+                               log_request_response{}, check_token{});
+
+  // 没有缓存的静态文件(超过缓存大小限制或启动后新增的)从磁盘读取，
+  // 放在最后注册，只处理其他路由都不匹配的请求
+  server.set_http_handler<GET>(
+      "/(.*)",
+      [](coro_http_request &req,
+         coro_http_response &resp) -> async_simple::coro::Lazy<void> {
+        auto url = req.get_url();
+        if (url.find("..") != std::string_view::npos) {
+          resp.set_status(status_type::not_found);
+          co_return;
+        }
+        std::string file_name;
+        file_name.append("html").append(url);
+        co_await send_file(req, resp, file_name, "public, max-age=3600");
+      });
   server.sync_start();
+
+  // 退出前写回还没落库的浏览量
+  view_counter::instance().stop();
+  site_stats::instance().stop();
+  count_cache::instance().stop();
+  tag_catalog::instance().stop();
+  blob_store::instance().stop();
+  comment_counter::instance().stop();
+  site_feeds::instance().stop();
 }
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "static_cache.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <cinatra.hpp>
+
+using namespace cinatra;
+
+namespace purecpp {
+
+struct byte_range {
+  uint64_t start;
+  uint64_t end; // 包含end
+};
+
+/**
+ * @brief 解析单个Range：bytes=a-b、bytes=a-、bytes=-n
+ * @param range Range请求头
+ * @param size 文件大小
+ * @return 多个区间或格式不支持时返回std::nullopt(按整个文件返回)；
+ * 区间超出文件时返回start大于end的区间(416)
+ */
+inline std::optional<byte_range> parse_range(std::string_view range,
+                                             uint64_t size) {
+  constexpr std::string_view unit = "bytes=";
+  if (!range.starts_with(unit) ||
+      range.find(',') != std::string_view::npos) {
+    return std::nullopt;
+  }
+  range.remove_prefix(unit.size());
+  size_t dash = range.find('-');
+  if (dash == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  auto parse = [](std::string_view s, uint64_t &value) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return ec == std::errc{} && ptr == s.data() + s.size();
+  };
+  auto first = range.substr(0, dash);
+  auto last = range.substr(dash + 1);
+  uint64_t start = 0, end = 0;
+  if (first.empty()) {
+    // 最后n个字节
+    if (!parse(last, end) || end == 0) {
+      return std::nullopt;
+    }
+    if (size == 0) {
+      return byte_range{1, 0};
+    }
+    return byte_range{end >= size ? 0 : size - end, size - 1};
+  }
+  if (!parse(first, start)) {
+    return std::nullopt;
+  }
+  if (last.empty()) {
+    end = size - 1;
+  } else if (!parse(last, end) || end < start) {
+    return std::nullopt;
+  }
+  if (start >= size) {
+    return byte_range{1, 0};
+  }
+  return byte_range{start, std::min(end, size - 1)};
+}
+
+/**
+ * @brief HTTP日期格式，如"Sun, 06 Nov 1994 08:49:37 GMT"
+ */
+inline std::string http_date(std::chrono::system_clock::time_point tp) {
+  using namespace std::chrono;
+  static constexpr const char *week_days[] = {"Sun", "Mon", "Tue", "Wed",
+                                              "Thu", "Fri", "Sat"};
+  static constexpr const char *months[] = {"Jan", "Feb", "Mar", "Apr",
+                                           "May", "Jun", "Jul", "Aug",
+                                           "Sep", "Oct", "Nov", "Dec"};
+  auto secs = floor<seconds>(tp);
+  auto day = floor<days>(secs);
+  year_month_day ymd{day};
+  hh_mm_ss hms{secs - day};
+  char buf[64];
+  int n = std::snprintf(buf, sizeof(buf), "%s, %02u %s %d %02d:%02d:%02d GMT",
+                        week_days[weekday{day}.c_encoding()],
+                        static_cast<unsigned>(ymd.day()),
+                        months[static_cast<unsigned>(ymd.month()) - 1],
+                        static_cast<int>(ymd.year()),
+                        static_cast<int>(hms.hours().count()),
+                        static_cast<int>(hms.minutes().count()),
+                        static_cast<int>(hms.seconds().count()));
+  return std::string(buf, n);
+}
+
+/**
+ * @brief 返回磁盘上的文件
+ *
+ * 支持ETag/Last-Modified条件请求和单个Range(206)。
+ * 服务开启了TLS无法使用sendfile，这里用较大的缓冲区分块读取，
+ * 自己写响应头并带上Content-Length，不再使用chunked编码。
+ * @param file_path 文件路径
+ * @param cache_control Cache-Control响应头
+ */
+inline async_simple::coro::Lazy<void>
+send_file(coro_http_request &req, coro_http_response &resp,
+          const std::filesystem::path &file_path,
+          std::string_view cache_control) {
+  std::error_code ec;
+  auto status = std::filesystem::status(file_path, ec);
+  if (ec || !std::filesystem::is_regular_file(status)) {
+    resp.set_status(status_type::not_found);
+    co_return;
+  }
+  uint64_t size = std::filesystem::file_size(file_path, ec);
+  auto mtime = std::filesystem::last_write_time(file_path, ec);
+  if (ec) {
+    resp.set_status(status_type::not_found);
+    co_return;
+  }
+
+  auto modified = std::chrono::file_clock::to_sys(mtime);
+  auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+                     modified.time_since_epoch())
+                     .count();
+  char etag_buf[64];
+  int etag_len = std::snprintf(etag_buf, sizeof(etag_buf), "\"%llx-%llx\"",
+                               static_cast<unsigned long long>(size),
+                               static_cast<unsigned long long>(seconds));
+  std::string etag(etag_buf, etag_len);
+  std::string last_modified = http_date(
+      std::chrono::system_clock::time_point(std::chrono::seconds(seconds)));
+
+  // 条件请求：If-None-Match优先于If-Modified-Since
+  auto if_none_match = req.get_header_value("if-none-match");
+  bool not_modified =
+      if_none_match.empty()
+          ? req.get_header_value("if-modified-since") == last_modified
+          : etag_matches(if_none_match, etag);
+  if (not_modified) {
+    resp.add_header("ETag", etag);
+    resp.add_header("Last-Modified", last_modified);
+    resp.add_header("Cache-Control", std::string(cache_control));
+    resp.set_status(status_type::not_modified);
+    co_return;
+  }
+
+  // If-Range不匹配时忽略Range，返回整个文件
+  std::optional<byte_range> range;
+  auto range_header = req.get_header_value("range");
+  auto if_range = req.get_header_value("if-range");
+  if (!range_header.empty() &&
+      (if_range.empty() || if_range == etag || if_range == last_modified)) {
+    range = parse_range(range_header, size);
+  }
+  if (range && range->start > range->end) {
+    resp.add_header("Content-Range", "bytes */" + std::to_string(size));
+    resp.set_status(status_type::range_not_satisfiable);
+    co_return;
+  }
+
+  coro_io::coro_file in_file{};
+  if (!in_file.open(file_path.string(), std::ios::in)) {
+    resp.set_status(status_type::not_found);
+    co_return;
+  }
+  uint64_t start = range ? range->start : 0;
+  uint64_t length = range ? range->end - range->start + 1 : size;
+  if (start > 0 && !in_file.seek(static_cast<long>(start), SEEK_SET)) {
+    resp.set_status(status_type::internal_server_error);
+    co_return;
+  }
+
+  auto mime = get_mime_type(get_extension(file_path.string()));
+  std::string header;
+  header.append(range ? "HTTP/1.1 206 Partial Content\r\n"
+                      : "HTTP/1.1 200 OK\r\n");
+  header.append("Content-Type: ").append(mime).append("\r\n");
+  header.append("Content-Length: ")
+      .append(std::to_string(length))
+      .append("\r\n");
+  if (range) {
+    header.append("Content-Range: bytes ")
+        .append(std::to_string(range->start))
+        .append("-")
+        .append(std::to_string(range->end))
+        .append("/")
+        .append(std::to_string(size))
+        .append("\r\n");
+  }
+  header.append("Accept-Ranges: bytes\r\n");
+  header.append("ETag: ").append(etag).append("\r\n");
+  header.append("Last-Modified: ").append(last_modified).append("\r\n");
+  header.append("Cache-Control: ").append(cache_control).append("\r\n\r\n");
+
+  // 响应由这里直接写出，框架不再发送
+  resp.set_delay(true);
+  if (!co_await resp.get_conn()->write_data(header)) {
+    co_return;
+  }
+
+  constexpr size_t buffer_size = 256 * 1024;
+  std::string buffer;
+  cinatra::detail::resize(buffer, std::min<uint64_t>(buffer_size, length));
+  while (length > 0) {
+    size_t n = std::min<uint64_t>(buffer.size(), length);
+    auto [read_ec, read_size] = co_await in_file.async_read(buffer.data(), n);
+    if (read_ec || read_size == 0) {
+      // 响应头已经发出，只能断开连接
+      resp.get_conn()->close();
+      co_return;
+    }
+    if (!co_await resp.get_conn()->write_data(
+            std::string_view(buffer.data(), read_size))) {
+      co_return;
+    }
+    length -= read_size;
+  }
+}
+} // namespace purecpp
@@ -449,6 +449,27 @@ class APIService {
         });
     }
 
+    // 订阅文章的新评论，每收到一条新评论调用一次onComment；
+    // 连接断开后浏览器会自动重连，断开期间的评论收不到，重连成功时调用onReconnect
+    subscribeArticleComments(slug, onComment, onReconnect) {
+        const source = new EventSource(
+            `${this.baseURL}/api/v1/comments/stream/${slug}`);
+        let interrupted = false;
+        source.addEventListener('comment', (event) => {
+            onComment(JSON.parse(event.data));
+        });
+        source.addEventListener('error', () => {
+            interrupted = true;
+        });
+        source.addEventListener('open', () => {
+            if (interrupted) {
+                interrupted = false;
+                onReconnect();
+            }
+        });
+        return source;
+    }
+
     // 添加文章评论
     async addArticleComment(slug, content, parentId = 0) {
         const userInfo = this.getUserInfo();
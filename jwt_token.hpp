@@ -1,12 +1,16 @@
 #pragma once
 #include "config.hpp"
+#include <array>
 #include <chrono>
 #include <cinatra.hpp>
+#include <functional>
 #include <mutex>
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace purecpp {
@@ -27,6 +31,103 @@ struct access_token_info {
   uint64_t exp; // 过期时间
 };
 
+/**
+ * @brief 已校验通过的access token缓存
+ *
+ * 每个需要登录的请求都要base64解码、计算HMAC、解析JSON，同一个token
+ * 在有效期内会被反复校验。校验通过后按签名缓存解析出的信息，之后的请求
+ * 只比较payload是否一致，不再计算HMAC。按签名分片，每个分片一把锁。
+ * 缓存的token过期即失效；加入黑名单时从缓存中删除。
+ */
+class verified_token_cache {
+public:
+  static verified_token_cache &instance() {
+    static verified_token_cache instance;
+    return instance;
+  }
+
+  std::optional<access_token_info> find(std::string_view payload,
+                                        std::string_view signature,
+                                        uint64_t now) {
+    auto &s = shard_of(signature);
+    std::lock_guard lock(s.mutex);
+    auto it = s.tokens.find(signature);
+    if (it == s.tokens.end()) {
+      return std::nullopt;
+    }
+    if (now > it->second.info.exp) {
+      s.tokens.erase(it);
+      return std::nullopt;
+    }
+    if (it->second.payload != payload) {
+      return std::nullopt;
+    }
+    return it->second.info;
+  }
+
+  void put(std::string_view payload, std::string_view signature,
+           const access_token_info &info, uint64_t now) {
+    auto &s = shard_of(signature);
+    std::lock_guard lock(s.mutex);
+    if (s.tokens.size() >= max_entries_per_shard) {
+      std::erase_if(s.tokens, [now](const auto &item) {
+        return now > item.second.info.exp;
+      });
+      if (s.tokens.size() >= max_entries_per_shard) {
+        s.tokens.erase(s.tokens.begin());
+      }
+    }
+    s.tokens.insert_or_assign(std::string(signature),
+                              entry{std::string(payload), info});
+  }
+
+  void erase(std::string_view token) {
+    size_t dot_pos = token.find('.');
+    if (dot_pos == std::string_view::npos) {
+      return;
+    }
+    auto signature = token.substr(dot_pos + 1);
+    auto &s = shard_of(signature);
+    std::lock_guard lock(s.mutex);
+    auto it = s.tokens.find(signature);
+    if (it != s.tokens.end()) {
+      s.tokens.erase(it);
+    }
+  }
+
+private:
+  verified_token_cache() = default;
+  verified_token_cache(const verified_token_cache &) = delete;
+  verified_token_cache &operator=(const verified_token_cache &) = delete;
+
+  static constexpr size_t shard_count = 16;
+  static constexpr size_t max_entries_per_shard = 4096;
+
+  struct string_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+
+  struct entry {
+    std::string payload; // base64编码的payload
+    access_token_info info;
+  };
+
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, entry, string_hash, std::equal_to<>>
+        tokens; // 签名 -> token信息
+  };
+
+  shard &shard_of(std::string_view signature) {
+    return shards_[string_hash{}(signature) % shard_count];
+  }
+
+  std::array<shard, shard_count> shards_;
+};
+
 // Token响应结构体，包含access token和refresh token
 struct token_response {
   std::string access_token;
@@ -144,10 +245,13 @@ public:
     return instance;
   }
 
-  // 添加令牌到黑名单
+  // 添加令牌到黑名单，并从已校验的token缓存中删除
   void add(const std::string &token) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    blacklist_.insert(token);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blacklist_.insert(token);
+    }
+    verified_token_cache::instance().erase(token);
   }
 
   // 检查令牌是否在黑名单中
@@ -278,18 +382,27 @@ token_response refresh_access_token(const std::string &refresh_token,
 // Token校验函数
 std::pair<TokenValidationResult, std::optional<access_token_info>>
 validate_jwt_token(const std::string &token) {
-  // 检查令牌是否在黑名单中
-  if (token_blacklist::instance().contains(token)) {
-    return {TokenValidationResult::Expired,
-            std::nullopt}; // 使用Expired状态表示已注销
-  }
-
   // 分割JWT，Payload.Signature
   size_t first_dot = token.find('.');
   if (first_dot == std::string::npos) {
     return {TokenValidationResult::InvalidFormat, std::nullopt};
   }
 
+  // 已校验过的token直接使用缓存的信息，加入黑名单的token已从缓存中删除
+  std::string_view token_view = token;
+  auto &cache = verified_token_cache::instance();
+  uint64_t now = get_timestamp_seconds();
+  if (auto cached = cache.find(token_view.substr(0, first_dot),
+                               token_view.substr(first_dot + 1), now)) {
+    return {TokenValidationResult::Valid, cached};
+  }
+
+  // 检查令牌是否在黑名单中
+  if (token_blacklist::instance().contains(token)) {
+    return {TokenValidationResult::Expired,
+            std::nullopt}; // 使用Expired状态表示已注销
+  }
+
   std::string encoded_payload = token.substr(0, first_dot);
   std::string encoded_signature = token.substr(first_dot + 1);
 
@@ -328,25 +441,13 @@ validate_jwt_token(const std::string &token) {
   if (current_time > info.exp) {
     return {TokenValidationResult::Expired, std::nullopt};
   }
-  return {TokenValidationResult::Valid, info};
-}
 
-/**
- * @brief 从请求中提取用户ID
- * @param req HTTP请求
- * @return 用户ID
- */
-uint64_t get_user_id_from_token(coro_http_request &req) {
-  auto aspect_data = req.params_["user_token"];
-  if (aspect_data.empty()) {
-    return 0;
-  }
-  access_token_info token_info;
-  std::error_code ec;
-  iguana::from_json(token_info, aspect_data, ec);
-  if (ec) {
-    return 0;
+  cache.put(encoded_payload, encoded_signature, info, now);
+  // 校验期间token被加入黑名单时，黑名单可能在写入缓存前已删除过缓存
+  if (token_blacklist::instance().contains(token)) {
+    cache.erase(token);
+    return {TokenValidationResult::Expired, std::nullopt};
   }
-  return token_info.user_id;
+  return {TokenValidationResult::Valid, info};
 }
 } // namespace purecpp
\ No newline at end of file
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace purecpp {
+
+namespace markdown_detail {
+inline bool is_space(char c) { return c == ' ' || c == '\t'; }
+
+inline bool is_word(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || static_cast<unsigned char>(c) >= 0x80;
+}
+
+// 一串连续的*或_
+struct delimiter_run {
+  size_t pos;
+  size_t len;
+  bool matched; // 有配对的另一端，作为强调标记去掉
+};
+
+/**
+ * @brief 找出一行中的强调符号并配对
+ *
+ * 后面紧跟非空白字符的可以作为开始，前面紧挨非空白字符的可以作为结束，
+ * 结束符号和最近的未配对的同字符、同长度的开始符号配对。没有配对的原样保留，
+ * 如int* p；夹在两个单词字符中间的不是强调，如2*3、snake_case。
+ */
+inline std::vector<delimiter_run> match_emphasis(std::string_view line) {
+  constexpr size_t max_len = 3; // ***粗斜体***，更长的不是强调
+  std::vector<delimiter_run> runs;
+  // 按(字符, 长度)分开的未配对开始符号，配对只需看栈顶
+  std::array<std::array<std::vector<size_t>, max_len>, 2> openers;
+  for (size_t i = 0; i < line.size();) {
+    char c = line[i];
+    if (c != '*' && c != '_') {
+      i++;
+      continue;
+    }
+    size_t end = i;
+    while (end < line.size() && line[end] == c) {
+      end++;
+    }
+    char before = i > 0 ? line[i - 1] : ' ';
+    char after = end < line.size() ? line[end] : ' ';
+    size_t len = end - i;
+    runs.push_back(delimiter_run{i, len, false});
+    i = end;
+    if (len > max_len || (is_word(before) && is_word(after))) {
+      continue;
+    }
+
+    auto &stack = openers[c == '*' ? 0 : 1][len - 1];
+    if (!is_space(before) && !stack.empty()) {
+      runs[stack.back()].matched = true;
+      runs.back().matched = true;
+      stack.pop_back();
+    } else if (!is_space(after)) {
+      stack.push_back(runs.size() - 1);
+    }
+  }
+  return runs;
+}
+
+// 行内扫描：链接、图片只保留文本，行内代码保留内容，去掉成对的强调符号
+class inline_scanner {
+public:
+  explicit inline_scanner(std::string &out) : out_(out) {}
+
+  void scan(std::string_view line) {
+    // 记录上一次查找的结果，保证整行只扫描常数遍
+    size_t next_bracket = 0, next_paren = 0, next_tick = 0;
+    auto runs = match_emphasis(line);
+    size_t next_run = 0;
+    size_t i = 0;
+    while (i < line.size()) {
+      char c = line[i];
+      bool image = c == '!' && i + 1 < line.size() && line[i + 1] == '[';
+      if (c == '[' || image) {
+        size_t open = image ? i + 1 : i;
+        size_t close = find_from(line, ']', open + 1, next_bracket);
+        if (close != std::string_view::npos && close + 1 < line.size() &&
+            line[close + 1] == '(') {
+          size_t end = find_from(line, ')', close + 2, next_paren);
+          if (end != std::string_view::npos) {
+            scan(line.substr(open + 1, close - open - 1));
+            i = end + 1;
+            continue;
+          }
+        }
+        out_.push_back(c);
+        i++;
+        continue;
+      }
+
+      if (c == '`') {
+        size_t close = find_from(line, '`', i + 1, next_tick);
+        if (close != std::string_view::npos) {
+          out_.append(line.substr(i + 1, close - i - 1));
+          i = close + 1;
+          continue;
+        }
+        out_.push_back(c);
+        i++;
+        continue;
+      }
+
+      if (c == '*' || c == '_') {
+        // 链接文字和行内代码中的符号已跳过，找到当前位置对应的一串
+        while (next_run < runs.size() && runs[next_run].pos < i) {
+          next_run++;
+        }
+        if (next_run < runs.size() && runs[next_run].pos == i) {
+          const auto &run = runs[next_run];
+          if (!run.matched) {
+            out_.append(line.substr(i, run.len));
+          }
+          i += run.len;
+          continue;
+        }
+        out_.push_back(c);
+        i++;
+        continue;
+      }
+
+      out_.push_back(c);
+      i++;
+    }
+  }
+
+private:
+  // 在line中从pos开始查找ch，cache记录上次找到的位置(加1，0表示未知，
+  // npos表示pos之后不存在)
+  static size_t find_from(std::string_view line, char ch, size_t pos,
+                          size_t &cache) {
+    if (cache == std::string_view::npos) {
+      return std::string_view::npos;
+    }
+    if (cache != 0 && cache - 1 >= pos) {
+      return cache - 1;
+    }
+    size_t found = line.find(ch, pos);
+    cache = found == std::string_view::npos ? found : found + 1;
+    return found;
+  }
+
+  std::string &out_;
+};
+} // namespace markdown_detail
+
+/**
+ * @brief 把markdown转换成纯文本，用于生成摘要和全文检索
+ *
+ * 单遍扫描：图片和链接只保留文本，去掉强调符号，行内代码保留内容，
+ * 去掉标题、列表、引用的行首标记，连续的换行合并成一个空格。
+ * @param keep_code 是否保留代码块的内容，默认整个代码块删除
+ */
+inline std::string cleanup_markdown(std::string_view markdown_text,
+                                    bool keep_code = false) {
+  using namespace markdown_detail;
+  std::string text;
+  text.reserve(markdown_text.size());
+  inline_scanner scanner(text);
+
+  bool in_fence = false;
+  bool pending_newline = false;
+  size_t pos = 0;
+  while (pos < markdown_text.size()) {
+    size_t eol = markdown_text.find('\n', pos);
+    bool has_newline = eol != std::string_view::npos;
+    std::string_view line = markdown_text.substr(
+        pos, has_newline ? eol - pos : std::string_view::npos);
+    pos = has_newline ? eol + 1 : markdown_text.size();
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+
+    size_t indent = 0;
+    while (indent < line.size() && is_space(line[indent])) {
+      indent++;
+    }
+    bool is_fence = line.substr(indent).starts_with("```");
+    size_t before = text.size();
+    if (is_fence) {
+      in_fence = !in_fence;
+    } else if (in_fence) {
+      if (keep_code) {
+        text.append(line);
+      }
+    } else {
+      // 标题
+      if (!line.empty() && line[0] == '#') {
+        size_t n = line.find_first_not_of('#');
+        if (n == std::string_view::npos || is_space(line[n])) {
+          line.remove_prefix(n == std::string_view::npos ? line.size() : n);
+          while (!line.empty() && is_space(line[0])) {
+            line.remove_prefix(1);
+          }
+        }
+      }
+      // 引用，可以嵌套
+      while (line.size() >= 2 && line[0] == '>' && is_space(line[1])) {
+        line.remove_prefix(2);
+      }
+      // 列表
+      if (line.size() >= 2 &&
+          (line[0] == '*' || line[0] == '-' || line[0] == '+') &&
+          is_space(line[1])) {
+        line.remove_prefix(2);
+      }
+      scanner.scan(line);
+    }
+
+    if (text.size() != before) {
+      pending_newline = false;
+    }
+    if (has_newline && !pending_newline) {
+      text.push_back(' ');
+      pending_newline = true;
+    }
+  }
+  return text;
+}
+} // namespace purecpp
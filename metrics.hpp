@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.hpp"
+#include "response_compress.hpp"
+#include "user_aspects.hpp"
+
+using namespace cinatra;
+
+namespace purecpp {
+class metrics {
+public:
+  /**
+   * @brief 接口响应压缩的统计，只有管理员可以查看
+   */
+  void get_compression_metrics(coro_http_request &req,
+                               coro_http_response &resp) {
+    auto user_id = get_user_id_from_token(req);
+    if (user_id == 0) {
+      resp.set_status_and_content(status_type::unauthorized,
+                                  make_error("用户未登录或登录已过期"));
+      return;
+    }
+
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      set_server_internel_error(resp);
+      return;
+    }
+
+    auto users_vect = conn->select(col(&users_t::role))
+                          .from<users_t>()
+                          .where(col(&users_t::id) == user_id)
+                          .collect();
+    if (users_vect.empty()) {
+      resp.set_status_and_content(status_type::bad_request,
+                                  make_error("无效的请求参数"));
+      return;
+    }
+
+    std::string role = std::get<0>(users_vect.front());
+    if (role != "admin" && role != "superadmin") {
+      resp.set_status_and_content(
+          status_type::forbidden,
+          make_error("权限不足，只有管理员可以查看压缩统计"));
+      return;
+    }
+
+    auto stats = compression_metrics::instance().stats();
+    resp.set_content_type<resp_content_type::json>();
+    resp.set_status_and_content(status_type::ok,
+                                make_data(stats, "获取压缩统计成功"));
+  }
+};
+} // namespace purecpp
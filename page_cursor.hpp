@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cinatra.hpp>
+
+namespace purecpp {
+
+/**
+ * @brief 游标分页的位置：上一页最后一条记录的排序键
+ *
+ * 内存中的文章列表按(置顶权重, created_at, id)降序排列，从这三个值之后继续；
+ * 数据库中的列表按主键id降序排列，下一页用id < 游标id定位，
+ * 不用OFFSET逐行跳过，同一时间创建的记录也不会重复或遗漏。
+ * 客户端拿到的是URL安全的base64字符串，应原样回传，不要解析。
+ */
+struct page_cursor {
+  int featured_weight = 0;
+  uint64_t created_at = 0;
+  uint64_t id = 0;
+};
+
+inline std::string encode_cursor(const page_cursor &cursor) {
+  std::string raw = std::to_string(cursor.featured_weight) + "," +
+                    std::to_string(cursor.created_at) + "," +
+                    std::to_string(cursor.id);
+  std::string encoded = cinatra::base64_encode(raw);
+  std::replace(encoded.begin(), encoded.end(), '+', '-');
+  std::replace(encoded.begin(), encoded.end(), '/', '_');
+  while (!encoded.empty() && encoded.back() == '=') {
+    encoded.pop_back();
+  }
+  return encoded;
+}
+
+/**
+ * @brief 解析游标，格式非法时返回std::nullopt
+ */
+inline std::optional<page_cursor> decode_cursor(std::string_view cursor) {
+  if (cursor.empty() || cursor.size() > 128) {
+    return std::nullopt;
+  }
+  std::string encoded(cursor);
+  std::replace(encoded.begin(), encoded.end(), '-', '+');
+  std::replace(encoded.begin(), encoded.end(), '_', '/');
+  while (encoded.size() % 4 != 0) {
+    encoded.push_back('=');
+  }
+  auto raw = cinatra::base64_decode(encoded);
+  if (!raw) {
+    return std::nullopt;
+  }
+
+  page_cursor result{};
+  std::string_view text = *raw;
+  auto parse = [&text](auto &value, bool last) {
+    auto end = last ? text.size() : text.find(',');
+    if (end == std::string_view::npos || end == 0) {
+      return false;
+    }
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + end, value);
+    if (ec != std::errc{} || ptr != text.data() + end) {
+      return false;
+    }
+    text.remove_prefix(last ? end : end + 1);
+    return true;
+  };
+  if (!parse(result.featured_weight, false) ||
+      !parse(result.created_at, false) || !parse(result.id, true)) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+/**
+ * @brief 按limit + 1条查询的结果截取一页，还有下一页时返回下一页的游标
+ * @param rows 查询结果，最多limit + 1条
+ * @param key_of 从一行数据得到page_cursor
+ */
+template <typename T, typename F>
+inline std::optional<std::string> take_page(std::vector<T> &rows, size_t limit,
+                                            F &&key_of) {
+  if (rows.size() <= limit) {
+    return std::nullopt;
+  }
+  rows.erase(rows.begin() + limit, rows.end());
+  if (rows.empty()) {
+    return std::nullopt;
+  }
+  return encode_cursor(key_of(rows.back()));
+}
+} // namespace purecpp
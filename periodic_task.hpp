@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace purecpp {
+
+/**
+ * @brief 后台周期任务：在独立线程中每隔interval执行一次task
+ *
+ * stop()会唤醒等待中的线程并等待其退出，析构时自动stop。
+ * task在后台线程中执行，不能阻塞太久，否则会推迟stop。
+ */
+class periodic_task {
+public:
+  periodic_task() = default;
+  periodic_task(const periodic_task &) = delete;
+  periodic_task &operator=(const periodic_task &) = delete;
+
+  ~periodic_task() { stop(); }
+
+  void start(std::chrono::milliseconds interval, std::function<void()> task) {
+    stop();
+    std::lock_guard lock(mutex_);
+    stopped_ = false;
+    thread_ = std::thread([this, interval, task = std::move(task)] {
+      std::unique_lock lock(mutex_);
+      while (!cv_.wait_for(lock, interval, [this] { return stopped_; })) {
+        lock.unlock();
+        task();
+        lock.lock();
+      }
+    });
+  }
+
+  void stop() {
+    {
+      std::lock_guard lock(mutex_);
+      stopped_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopped_ = true;
+  std::thread thread_;
+};
+} // namespace purecpp
@@ -0,0 +1,73 @@
+#pragma once
+#include "jwt_token.hpp"
+
+#include <any>
+#include <cinatra.hpp>
+#include <optional>
+#include <utility>
+
+namespace purecpp {
+
+/**
+ * @brief 请求的切面数据
+ *
+ * cinatra的请求只有一个user_data，check_token保存的token信息和
+ * 各接口参数校验切面保存的请求参数都放在这个结构中，互不覆盖。
+ */
+struct request_data {
+  std::optional<access_token_info> token;
+  std::any value; // 接口的请求参数
+};
+
+inline request_data load_request_data(coro_http_request &req) {
+  auto data = req.get_user_data();
+  if (auto ptr = std::any_cast<request_data>(&data)) {
+    return std::move(*ptr);
+  }
+  return {};
+}
+
+/**
+ * @brief 保存参数校验后的请求参数，保留已保存的token信息
+ */
+template <typename T> void set_request_data(coro_http_request &req, T value) {
+  auto data = load_request_data(req);
+  data.value = std::move(value);
+  req.set_user_data(std::move(data));
+}
+
+/**
+ * @brief 获取切面保存的请求参数，类型不一致时抛出std::bad_any_cast
+ */
+template <typename T> T get_request_data(coro_http_request &req) {
+  return std::any_cast<T>(load_request_data(req).value);
+}
+
+/**
+ * @brief 保存校验通过的token信息，供后续的切面和接口使用
+ */
+inline void set_token_info(coro_http_request &req,
+                           const access_token_info &info) {
+  auto data = load_request_data(req);
+  data.token = info;
+  req.set_user_data(std::move(data));
+}
+
+/**
+ * @brief 获取check_token保存的token信息
+ * @return 请求没有经过check_token时返回std::nullopt
+ */
+inline std::optional<access_token_info> get_token_info(coro_http_request &req) {
+  return load_request_data(req).token;
+}
+
+/**
+ * @brief 从请求中提取用户ID
+ * @param req HTTP请求
+ * @return 用户ID
+ */
+inline uint64_t get_user_id_from_token(coro_http_request &req) {
+  auto info = get_token_info(req);
+  return info ? info->user_id : 0;
+}
+} // namespace purecpp
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "config.hpp"
+#include "static_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <cinatra.hpp>
+#include <zlib.h>
+
+using namespace cinatra;
+
+namespace purecpp {
+
+enum class compress_format { gzip, deflate };
+
+/**
+ * @brief 可复用的zlib压缩流
+ *
+ * deflateInit2会分配几百KB的内部状态，每次响应都初始化开销很大。
+ * 每个线程为每种格式保留一个流，压缩前用deflateReset重置即可复用。
+ */
+class zlib_compressor {
+public:
+  explicit zlib_compressor(compress_format format) {
+    // windowBits加16输出gzip格式，否则输出zlib格式(HTTP的deflate)
+    int window_bits = format == compress_format::gzip ? 15 + 16 : 15;
+    ok_ = deflateInit2(&zs_, compress_level, Z_DEFLATED, window_bits, 8,
+                       Z_DEFAULT_STRATEGY) == Z_OK;
+  }
+
+  ~zlib_compressor() {
+    if (ok_) {
+      deflateEnd(&zs_);
+    }
+  }
+
+  zlib_compressor(const zlib_compressor &) = delete;
+  zlib_compressor &operator=(const zlib_compressor &) = delete;
+
+  /**
+   * @brief 当前线程的压缩流
+   */
+  static zlib_compressor &local(compress_format format) {
+    thread_local zlib_compressor gzip(compress_format::gzip);
+    thread_local zlib_compressor deflate(compress_format::deflate);
+    return format == compress_format::gzip ? gzip : deflate;
+  }
+
+  /**
+   * @brief 压缩data，失败时返回false
+   */
+  bool compress(std::string_view data, std::string &out) {
+    if (!ok_ || deflateReset(&zs_) != Z_OK) {
+      return false;
+    }
+    out.resize(deflateBound(&zs_, data.size()));
+    zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    zs_.avail_in = static_cast<uInt>(data.size());
+    zs_.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs_.avail_out = static_cast<uInt>(out.size());
+    int ret = deflate(&zs_, Z_FINISH);
+    out.resize(zs_.total_out);
+    return ret == Z_STREAM_END;
+  }
+
+private:
+  // 接口响应是动态生成的，用速度和压缩率折中的级别
+  static constexpr int compress_level = 6;
+
+  z_stream zs_{};
+  bool ok_ = false;
+};
+
+struct compression_stats {
+  uint64_t responses;       // 压缩的响应数
+  uint64_t bytes_in;        // 压缩前的字节数
+  uint64_t bytes_out;       // 压缩后的字节数
+  uint64_t bytes_saved;
+  uint64_t compress_micros; // 压缩耗时（微秒）
+};
+
+/**
+ * @brief 接口响应压缩的统计
+ */
+class compression_metrics {
+public:
+  static compression_metrics &instance() {
+    static compression_metrics instance;
+    return instance;
+  }
+
+  void record(size_t bytes_in, size_t bytes_out, uint64_t nanos) {
+    responses_.fetch_add(1, std::memory_order_relaxed);
+    bytes_in_.fetch_add(bytes_in, std::memory_order_relaxed);
+    bytes_out_.fetch_add(bytes_out, std::memory_order_relaxed);
+    nanos_.fetch_add(nanos, std::memory_order_relaxed);
+  }
+
+  compression_stats stats() const {
+    compression_stats s{};
+    s.responses = responses_.load(std::memory_order_relaxed);
+    s.bytes_in = bytes_in_.load(std::memory_order_relaxed);
+    s.bytes_out = bytes_out_.load(std::memory_order_relaxed);
+    s.bytes_saved = s.bytes_in > s.bytes_out ? s.bytes_in - s.bytes_out : 0;
+    s.compress_micros = nanos_.load(std::memory_order_relaxed) / 1000;
+    return s;
+  }
+
+private:
+  compression_metrics() = default;
+  compression_metrics(const compression_metrics &) = delete;
+  compression_metrics &operator=(const compression_metrics &) = delete;
+
+  std::atomic<uint64_t> responses_{0};
+  std::atomic<uint64_t> bytes_in_{0};
+  std::atomic<uint64_t> bytes_out_{0};
+  std::atomic<uint64_t> nanos_{0};
+};
+
+/**
+ * @brief 压缩接口响应的切面
+ *
+ * 响应体超过compress_min_bytes且客户端接受gzip或deflate时压缩响应体，
+ * 压缩后没有变小则保持原样。需要放在切面列表的最后，
+ * 让日志等切面看到的仍是压缩前的内容。
+ */
+struct compress_response {
+  bool after(coro_http_request &req, coro_http_response &res) {
+    auto body = res.content();
+    size_t min_bytes =
+        purecpp_config::get_instance().user_cfg_.compress_min_bytes;
+    if (min_bytes == 0 || body.size() < min_bytes) {
+      return true;
+    }
+
+    auto accept_encoding = req.get_header_value("accept-encoding");
+    compress_format format;
+    if (accepts_encoding(accept_encoding, "gzip")) {
+      format = compress_format::gzip;
+    } else if (accepts_encoding(accept_encoding, "deflate")) {
+      format = compress_format::deflate;
+    } else {
+      return true;
+    }
+
+    // 压缩是同步的纯计算，不会让出线程，耗时近似为消耗的CPU时间
+    auto begin = std::chrono::steady_clock::now();
+    std::string compressed;
+    bool ok = zlib_compressor::local(format).compress(body, compressed);
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+    if (!ok || compressed.size() >= body.size()) {
+      return true;
+    }
+
+    compression_metrics::instance().record(body.size(), compressed.size(),
+                                           nanos);
+    res.add_header("Content-Encoding",
+                   format == compress_format::gzip ? "gzip" : "deflate");
+    res.add_header("Vary", "Accept-Encoding");
+    res.set_status_and_content(res.status(), std::move(compressed));
+    return true;
+  }
+};
+} // namespace purecpp
@@ -0,0 +1,418 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+#include "markdown.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace purecpp {
+
+namespace search_detail {
+inline bool is_word_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+// 解码一个UTF-8字符，返回码点和字节数，非法序列按单字节处理
+inline std::pair<uint32_t, size_t> decode_utf8(std::string_view text,
+                                               size_t pos) {
+  unsigned char c = text[pos];
+  size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+  if (len == 1 || pos + len > text.size()) {
+    return {c, 1};
+  }
+  uint32_t cp = c & (0x3F >> (len - 1));
+  for (size_t i = 1; i < len; ++i) {
+    unsigned char next = text[pos + i];
+    if ((next & 0xC0) != 0x80) {
+      return {c, 1};
+    }
+    cp = (cp << 6) | (next & 0x3F);
+  }
+  return {cp, len};
+}
+
+inline bool is_cjk(uint32_t cp) {
+  return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) ||
+         (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x3040 && cp <= 0x30FF) ||
+         (cp >= 0xAC00 && cp <= 0xD7AF) || (cp >= 0x20000 && cp <= 0x2A6DF);
+}
+} // namespace search_detail
+
+/**
+ * @brief 分词：ASCII单词转小写；C++限定名(如std::vector)同时输出整体和各段，
+ * 单词后紧跟的++一并保留(c++)；连续的中日韩字符按二元组切分
+ * @param emit 回调，参数为std::string词项
+ * @param unigrams 是否为每个中日韩字符输出单字。建索引时为true，
+ * 单字查询才能命中；查询时为false，多字查询只用二元组，单字仍然单独输出
+ */
+template <typename F>
+void tokenize(std::string_view text, F &&emit, bool unigrams = true) {
+  using namespace search_detail;
+  std::vector<std::string_view> cjk_run;
+  auto flush_cjk = [&] {
+    if (unigrams || cjk_run.size() == 1) {
+      for (auto ch : cjk_run) {
+        emit(std::string(ch));
+      }
+    }
+    for (size_t i = 1; i < cjk_run.size(); ++i) {
+      std::string term(cjk_run[i - 1]);
+      term.append(cjk_run[i]);
+      emit(std::move(term));
+    }
+    cjk_run.clear();
+  };
+
+  size_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    if (is_word_char(c)) {
+      flush_cjk();
+      std::string word;
+      std::vector<std::string> parts;
+      size_t part_start = 0;
+      while (i < text.size()) {
+        if (is_word_char(text[i])) {
+          char ch = text[i++];
+          word.push_back((ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch);
+        } else if (text.substr(i, 2) == "::" && i + 2 < text.size() &&
+                 is_word_char(text[i + 2]) && !word.empty()) {
+          parts.push_back(word.substr(part_start));
+          word.append("::");
+          part_start = word.size();
+          i += 2;
+        } else {
+          break;
+        }
+      }
+      if (text.substr(i, 2) == "++") {
+        word.append("++");
+        i += 2;
+      }
+      if (!parts.empty()) {
+        parts.push_back(word.substr(part_start));
+        for (auto &part : parts) {
+          emit(std::move(part));
+        }
+      }
+      emit(std::move(word));
+      continue;
+    }
+
+    auto [cp, len] = decode_utf8(text, i);
+    if (is_cjk(cp)) {
+      cjk_run.push_back(text.substr(i, len));
+    } else {
+      flush_cjk();
+    }
+    i += len;
+  }
+  flush_cjk();
+}
+
+// 建索引用的文章字段
+struct search_doc {
+  uint64_t article_id;
+  std::string slug;
+  std::string title;
+  std::string abstraction;
+  std::string content;
+  std::string status;
+  bool is_deleted;
+};
+
+struct search_hit {
+  uint64_t article_id;
+  std::string slug;
+  double score;
+};
+
+/**
+ * @brief 文章全文检索的内存倒排索引
+ *
+ * 对标题、摘要、正文分词后建立倒排表，查询时要求包含全部查询词，按BM25排序。
+ * 只索引已发布和待审核的文章，启动时分批加载，文章发布、编辑、审核、删除后
+ * 通过refresh单篇更新。每篇文章只取正文前max_content_bytes字节、最多
+ * max_terms_per_doc个不同词项，以限制内存占用。
+ */
+class search_index {
+public:
+  static search_index &instance() {
+    static search_index instance;
+    return instance;
+  }
+
+  /**
+   * @brief 从数据库分批加载文章并建立索引
+   */
+  bool init() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "search index init failed: no db connection";
+      return false;
+    }
+
+    std::unique_lock lock(mutex_);
+    postings_.clear();
+    docs_.clear();
+    total_length_ = 0;
+
+    uint64_t last_id = 0;
+    size_t batch = 200;
+    while (true) {
+      auto rows = conn->select(col(&articles_t::article_id),
+                               col(&articles_t::slug), col(&articles_t::title),
+                               col(&articles_t::abstraction),
+                               col(&articles_t::content),
+                               col(&articles_t::status),
+                               col(&articles_t::is_deleted))
+                      .from<articles_t>()
+                      .where(col(&articles_t::article_id) > last_id)
+                      .order_by(col(&articles_t::article_id).asc())
+                      .limit(ormpp::token)
+                      .collect<search_doc>(batch);
+      for (const auto &doc : rows) {
+        if (indexable(doc)) {
+          add_locked(doc, false);
+        }
+      }
+      if (rows.size() < batch) {
+        break;
+      }
+      last_id = rows.back().article_id;
+    }
+
+    for (auto &[term, list] : postings_) {
+      std::sort(list.begin(), list.end());
+    }
+    CINATRA_LOG_INFO << "search index loaded " << docs_.size()
+                     << " articles, " << postings_.size() << " terms";
+    return true;
+  }
+
+  /**
+   * @brief 按slug重新索引单篇文章，文章已删除或不在可检索状态时移除
+   */
+  void refresh(std::string_view slug) {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "search index refresh failed: no db connection";
+      return;
+    }
+
+    auto rows = conn->select(col(&articles_t::article_id),
+                             col(&articles_t::slug), col(&articles_t::title),
+                             col(&articles_t::abstraction),
+                             col(&articles_t::content),
+                             col(&articles_t::status),
+                             col(&articles_t::is_deleted))
+                    .from<articles_t>()
+                    .where(col(&articles_t::slug).param())
+                    .collect<search_doc>(std::string(slug));
+    if (rows.empty()) {
+      return;
+    }
+
+    const auto &doc = rows.front();
+    std::unique_lock lock(mutex_);
+    remove_locked(doc.article_id);
+    if (indexable(doc)) {
+      add_locked(doc, true);
+    }
+  }
+
+  /**
+   * @brief 检索文章
+   * @param query 查询关键词
+   * @param status 文章状态，只返回该状态的文章
+   * @return 按BM25得分降序排列的结果
+   */
+  std::vector<search_hit> search(std::string_view query,
+                                 std::string_view status) {
+    std::vector<std::string> terms;
+    tokenize(
+        query,
+        [&](std::string term) {
+          if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+            terms.push_back(std::move(term));
+          }
+        },
+        false);
+
+    std::vector<search_hit> hits;
+    if (terms.empty()) {
+      return hits;
+    }
+
+    std::shared_lock lock(mutex_);
+    std::vector<const std::vector<posting> *> lists;
+    for (const auto &term : terms) {
+      auto it = postings_.find(term);
+      if (it == postings_.end()) {
+        return hits;
+      }
+      lists.push_back(&it->second);
+    }
+    // 从最短的倒排表开始求交集
+    std::sort(lists.begin(), lists.end(),
+              [](auto a, auto b) { return a->size() < b->size(); });
+
+    double n = static_cast<double>(docs_.size());
+    double avg_length = docs_.empty() ? 1.0 : total_length_ / n;
+    std::vector<double> idf;
+    for (auto list : lists) {
+      double df = static_cast<double>(list->size());
+      idf.push_back(std::log(1.0 + (n - df + 0.5) / (df + 0.5)));
+    }
+
+    for (const auto &first : *lists[0]) {
+      auto doc_it = docs_.find(first.article_id);
+      if (doc_it == docs_.end() || doc_it->second.status != status) {
+        continue;
+      }
+      const auto &doc = doc_it->second;
+      double norm = k1 * (1 - b + b * doc.length / avg_length);
+      double score = 0;
+      bool matched = true;
+      for (size_t i = 0; i < lists.size(); ++i) {
+        const posting *p = &first;
+        if (i > 0) {
+          auto it = std::lower_bound(lists[i]->begin(), lists[i]->end(),
+                                     posting{first.article_id, 0});
+          if (it == lists[i]->end() || it->article_id != first.article_id) {
+            matched = false;
+            break;
+          }
+          p = &*it;
+        }
+        score += idf[i] * p->tf * (k1 + 1) / (p->tf + norm);
+      }
+      if (matched) {
+        hits.push_back(search_hit{first.article_id, doc.slug, score});
+      }
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const auto &a, const auto &b) {
+      if (a.score != b.score) {
+        return a.score > b.score;
+      }
+      return a.article_id > b.article_id;
+    });
+    return hits;
+  }
+
+private:
+  search_index() = default;
+  search_index(const search_index &) = delete;
+  search_index &operator=(const search_index &) = delete;
+
+  // BM25参数
+  static constexpr double k1 = 1.2;
+  static constexpr double b = 0.75;
+  // 字段权重
+  static constexpr float title_weight = 3.0f;
+  static constexpr float abstraction_weight = 2.0f;
+  static constexpr float content_weight = 1.0f;
+  // 单篇文章的索引上限
+  static constexpr size_t max_content_bytes = 64 * 1024;
+  static constexpr size_t max_terms_per_doc = 4096;
+
+  struct posting {
+    uint64_t article_id;
+    float tf; // 按字段加权的词频
+
+    bool operator<(const posting &other) const {
+      return article_id < other.article_id;
+    }
+  };
+
+  struct doc_info {
+    std::string slug;
+    std::string status;
+    float length;                          // 按字段加权的词数
+    std::vector<const std::string *> terms; // 指向postings_中的键
+  };
+
+  static bool indexable(const search_doc &doc) {
+    return !doc.is_deleted &&
+           (doc.status == PUBLISHED || doc.status == PENDING_REVIEW);
+  }
+
+  void add_locked(const search_doc &doc, bool keep_sorted) {
+    std::unordered_map<std::string, float> tf;
+    float length = 0;
+    auto add_field = [&](std::string_view text, float weight) {
+      tokenize(text, [&](std::string term) {
+        length += weight;
+        auto it = tf.find(term);
+        if (it != tf.end()) {
+          it->second += weight;
+        } else if (tf.size() < max_terms_per_doc) {
+          tf.emplace(std::move(term), weight);
+        }
+      });
+    };
+    add_field(doc.title, title_weight);
+    add_field(doc.abstraction, abstraction_weight);
+    // 正文去掉markdown标记后再分词，代码块保留，方便搜索代码中的标识符
+    add_field(cleanup_markdown(std::string_view(doc.content)
+                                   .substr(0, max_content_bytes),
+                               true),
+              content_weight);
+
+    doc_info info{doc.slug, doc.status, length, {}};
+    info.terms.reserve(tf.size());
+    for (auto &[term, freq] : tf) {
+      auto [it, inserted] = postings_.try_emplace(term);
+      auto &list = it->second;
+      posting p{doc.article_id, freq};
+      if (keep_sorted) {
+        list.insert(std::lower_bound(list.begin(), list.end(), p), p);
+      } else {
+        list.push_back(p);
+      }
+      info.terms.push_back(&it->first);
+    }
+    total_length_ += length;
+    docs_[doc.article_id] = std::move(info);
+  }
+
+  void remove_locked(uint64_t article_id) {
+    auto doc_it = docs_.find(article_id);
+    if (doc_it == docs_.end()) {
+      return;
+    }
+    for (const std::string *term : doc_it->second.terms) {
+      auto it = postings_.find(*term);
+      if (it == postings_.end()) {
+        continue;
+      }
+      auto &list = it->second;
+      auto p = std::lower_bound(list.begin(), list.end(),
+                                posting{article_id, 0});
+      if (p != list.end() && p->article_id == article_id) {
+        list.erase(p);
+      }
+      if (list.empty()) {
+        postings_.erase(it);
+      }
+    }
+    total_length_ -= doc_it->second.length;
+    docs_.erase(doc_it);
+  }
+
+  std::shared_mutex mutex_;
+  std::unordered_map<std::string, std::vector<posting>> postings_; // 词项 -> 文章
+  std::unordered_map<uint64_t, doc_info> docs_; // article_id -> 文章信息
+  double total_length_ = 0;
+};
+} // namespace purecpp
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "articles_dto.hpp"
+#include "config.hpp"
+#include "periodic_task.hpp"
+#include "static_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cinatra.hpp>
+
+using namespace cinatra;
+
+namespace purecpp {
+
+/**
+ * @brief XML文本和属性值转义
+ */
+inline std::string xml_escape(std::string_view text) {
+  std::string out;
+  out.reserve(text.size());
+  for (char c : text) {
+    switch (c) {
+    case '&':
+      out.append("&amp;");
+      break;
+    case '<':
+      out.append("&lt;");
+      break;
+    case '>':
+      out.append("&gt;");
+      break;
+    case '"':
+      out.append("&quot;");
+      break;
+    case '\'':
+      out.append("&apos;");
+      break;
+    default:
+      out.push_back(c);
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief 毫秒时间戳转为RFC 3339格式(UTC)，如"2024-01-02T03:04:05Z"
+ */
+inline std::string rfc3339_time(uint64_t timestamp_ms) {
+  using namespace std::chrono;
+  sys_seconds secs{seconds(timestamp_ms / 1000)};
+  auto day = floor<days>(secs);
+  year_month_day ymd{day};
+  hh_mm_ss hms{secs - day};
+  char buf[32];
+  int n = std::snprintf(buf, sizeof(buf), "%04d-%02u-%02uT%02d:%02d:%02dZ",
+                        static_cast<int>(ymd.year()),
+                        static_cast<unsigned>(ymd.month()),
+                        static_cast<unsigned>(ymd.day()),
+                        static_cast<int>(hms.hours().count()),
+                        static_cast<int>(hms.minutes().count()),
+                        static_cast<int>(hms.seconds().count()));
+  return std::string(buf, n);
+}
+
+/**
+ * @brief sitemap.xml和Atom订阅
+ *
+ * 每篇已发布文章的<url>和<entry>片段只在文章发布、编辑时生成一次。
+ * 文章变化只标记文档过期，后台任务每秒检查一次，把这段时间内的多次变化合并，
+ * 用缓存的片段重新拼接整个文档，再在锁外压缩并计算ETag。
+ * 文档以不可变快照的形式发布，请求时直接返回，不访问数据库，
+ * If-None-Match匹配时返回304。
+ */
+class site_feeds {
+public:
+  static constexpr std::string_view cache_control = "public, max-age=600";
+
+  static site_feeds &instance() {
+    static site_feeds instance;
+    return instance;
+  }
+
+  /**
+   * @brief 用全部已发布文章重新生成
+   */
+  void rebuild(const std::vector<article_list> &articles) {
+    {
+      std::lock_guard lock(mutex_);
+      items_.clear();
+      recent_.clear();
+      for (const auto &article : articles) {
+        put_locked(article.slug, render(article));
+      }
+      dirty_ = true;
+    }
+    publish();
+  }
+
+  /**
+   * @brief 文章发布或编辑后更新对应的片段
+   */
+  void upsert(const article_list &article) {
+    auto item = render(article);
+    std::lock_guard lock(mutex_);
+    auto it = items_.find(article.slug);
+    if (it != items_.end()) {
+      // 加精华等不影响订阅内容的修改不重新生成文档
+      if (item.url == it->second.url && item.entry == it->second.entry) {
+        return;
+      }
+      recent_.erase({it->second.created_at, article.slug});
+    }
+    put_locked(article.slug, std::move(item));
+    dirty_ = true;
+  }
+
+  /**
+   * @brief 文章删除或下线后移除对应的片段
+   */
+  void remove(std::string_view slug) {
+    std::lock_guard lock(mutex_);
+    auto it = items_.find(std::string(slug));
+    if (it == items_.end()) {
+      return;
+    }
+    recent_.erase({it->second.created_at, it->first});
+    items_.erase(it);
+    dirty_ = true;
+  }
+
+  /**
+   * @brief 启动后台任务，发布文章变化后过期的文档
+   */
+  void start() {
+    task_.start(std::chrono::seconds(1), [this] { publish(); });
+  }
+
+  void stop() { task_.stop(); }
+
+  static_route sitemap() const {
+    return static_route{sitemap_.load(), cache_control};
+  }
+
+  static_route atom() const {
+    return static_route{atom_.load(), cache_control};
+  }
+
+private:
+  site_feeds() = default;
+  site_feeds(const site_feeds &) = delete;
+  site_feeds &operator=(const site_feeds &) = delete;
+
+  // 单个sitemap文件最多50000个URL
+  static constexpr size_t max_sitemap_urls = 50000;
+  static constexpr size_t max_atom_entries = 20;
+
+  struct feed_item {
+    uint64_t created_at;
+    uint64_t updated_at;
+    std::string url;   // sitemap的<url>片段
+    std::string entry; // Atom的<entry>片段
+  };
+
+  static std::string base_url() {
+    std::string url = purecpp_config::get_instance().user_cfg_.web_server_url;
+    while (!url.empty() && url.back() == '/') {
+      url.pop_back();
+    }
+    return url;
+  }
+
+  static feed_item render(const article_list &article) {
+    auto link = xml_escape(base_url() + "/article.html?slug=" + article.slug);
+    auto updated = rfc3339_time(article.updated_at);
+
+    feed_item item{article.created_at, article.updated_at};
+    item.url.append("<url><loc>")
+        .append(link)
+        .append("</loc><lastmod>")
+        .append(updated)
+        .append("</lastmod></url>\n");
+    item.entry.append("<entry><title>")
+        .append(xml_escape(article.title))
+        .append("</title><link href=\"")
+        .append(link)
+        .append("\"/><id>")
+        .append(link)
+        .append("</id><published>")
+        .append(rfc3339_time(article.created_at))
+        .append("</published><updated>")
+        .append(updated)
+        .append("</updated><author><name>")
+        .append(xml_escape(article.author_name))
+        .append("</name></author><summary>")
+        .append(xml_escape(article.summary))
+        .append("</summary></entry>\n");
+    return item;
+  }
+
+  void put_locked(const std::string &slug, feed_item item) {
+    recent_.emplace(item.created_at, slug);
+    items_[slug] = std::move(item);
+  }
+
+  static std::shared_ptr<const static_asset>
+  make_asset(std::string content, std::string_view content_type) {
+    static_asset asset{};
+    asset.content = std::move(content);
+    auto gzip = gzip_compress(asset.content);
+    asset.etag = make_etag(asset.content);
+    if (!gzip.empty() && gzip.size() < asset.content.size()) {
+      asset.gzip = std::move(gzip);
+      asset.gzip_etag = make_gzip_etag(asset.etag);
+    }
+    asset.content_type = std::string(content_type);
+    return std::make_shared<const static_asset>(std::move(asset));
+  }
+
+  // 文档过期时用缓存的片段拼接文档，在锁外压缩后发布新快照
+  void publish() {
+    std::lock_guard publish_lock(publish_mutex_);
+    std::unique_lock lock(mutex_);
+    if (!dirty_) {
+      return;
+    }
+    dirty_ = false;
+    auto base = base_url();
+
+    std::string sitemap;
+    sitemap.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<urlset xmlns="
+                   "\"http://www.sitemaps.org/schemas/sitemap/0.9\">\n");
+    sitemap.append("<url><loc>").append(xml_escape(base)).append(
+        "/</loc></url>\n");
+    size_t urls = 1;
+    for (const auto &[slug, item] : items_) {
+      if (urls++ >= max_sitemap_urls) {
+        break;
+      }
+      sitemap.append(item.url);
+    }
+    sitemap.append("</urlset>\n");
+
+    // 最近发布的文章，订阅的更新时间取其中最新的修改时间
+    std::string entries;
+    uint64_t updated_at = 0;
+    size_t count = 0;
+    for (auto it = recent_.rbegin();
+         it != recent_.rend() && count < max_atom_entries; ++it, ++count) {
+      const auto &item = items_.at(it->second);
+      entries.append(item.entry);
+      updated_at = std::max(updated_at, item.updated_at);
+    }
+    std::string atom;
+    atom.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<feed xmlns=\"http://www.w3.org/2005/Atom\">\n"
+                "<title>PureCpp</title>\n");
+    atom.append("<link href=\"")
+        .append(xml_escape(base))
+        .append("/feed.atom\" rel=\"self\"/>\n");
+    atom.append("<link href=\"").append(xml_escape(base)).append("/\"/>\n");
+    atom.append("<id>").append(xml_escape(base)).append("/</id>\n");
+    atom.append("<updated>")
+        .append(rfc3339_time(updated_at))
+        .append("</updated>\n");
+    atom.append(entries);
+    atom.append("</feed>\n");
+    lock.unlock();
+
+    sitemap_.store(
+        make_asset(std::move(sitemap), "application/xml; charset=utf-8"));
+    atom_.store(
+        make_asset(std::move(atom), "application/atom+xml; charset=utf-8"));
+  }
+
+  std::mutex publish_mutex_; // 串行化发布，旧快照不会覆盖新快照
+  std::mutex mutex_;         // 串行化片段的修改和文档的拼接
+  bool dirty_ = false;       // 片段修改后文档还没有重新发布
+  std::map<std::string, feed_item> items_; // slug -> 片段
+  std::set<std::pair<uint64_t, std::string>> recent_; // (创建时间, slug)
+  std::atomic<std::shared_ptr<const static_asset>> sitemap_ =
+      make_asset({}, "application/xml; charset=utf-8");
+  std::atomic<std::shared_ptr<const static_asset>> atom_ =
+      make_asset({}, "application/atom+xml; charset=utf-8");
+  periodic_task task_;
+};
+} // namespace purecpp
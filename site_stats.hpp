@@ -0,0 +1,111 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+#include "periodic_task.hpp"
+
+#include <atomic>
+
+namespace purecpp {
+
+/**
+ * @brief 站点统计数据：注册会员数和已发布文章数
+ *
+ * 启动时从数据库加载一次，之后在邮箱验证通过、文章发布和下线时增量更新，
+ * /api/v1/stats直接读内存。后台定期和数据库对账，修正漏记的变化。
+ */
+class site_stats {
+public:
+  static site_stats &instance() {
+    static site_stats instance;
+    return instance;
+  }
+
+  /**
+   * @brief 从数据库加载统计数据
+   */
+  bool init() {
+    if (!reconcile()) {
+      CINATRA_LOG_ERROR << "site stats init failed";
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 启动后台对账
+   * @param interval_seconds 对账间隔（秒）
+   */
+  void start(int interval_seconds) {
+    if (interval_seconds <= 0) {
+      interval_seconds = 300;
+    }
+    task_.start(std::chrono::seconds(interval_seconds),
+                [this] { reconcile(); });
+  }
+
+  void stop() { task_.stop(); }
+
+  void add_users(int64_t n) {
+    changes_.fetch_add(1, std::memory_order_relaxed);
+    user_count_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void add_articles(int64_t n) {
+    if (n == 0) {
+      return;
+    }
+    changes_.fetch_add(1, std::memory_order_relaxed);
+    article_count_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  int64_t user_count() const {
+    return user_count_.load(std::memory_order_relaxed);
+  }
+
+  int64_t article_count() const {
+    return article_count_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 用数据库中的数据覆盖内存中的统计，
+   * 查询期间有增量更新时本次结果可能已过期，跳过等下次对账
+   */
+  bool reconcile() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      return false;
+    }
+
+    auto changes = changes_.load(std::memory_order_acquire);
+    int64_t users = conn->select(ormpp::count()).from<users_t>().collect();
+    int64_t articles = conn->select(ormpp::count())
+                           .from<articles_t>()
+                           .where(col(&articles_t::is_deleted) == 0 &&
+                                  col(&articles_t::status) == PUBLISHED.data())
+                           .collect();
+    if (changes_.load(std::memory_order_acquire) != changes) {
+      return true;
+    }
+
+    if (users != user_count() || articles != article_count()) {
+      CINATRA_LOG_INFO << "site stats reconciled, users: " << user_count()
+                       << " -> " << users << ", articles: " << article_count()
+                       << " -> " << articles;
+    }
+    user_count_.store(users, std::memory_order_relaxed);
+    article_count_.store(articles, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  site_stats() = default;
+  site_stats(const site_stats &) = delete;
+  site_stats &operator=(const site_stats &) = delete;
+
+  std::atomic<int64_t> user_count_ = 0;
+  std::atomic<int64_t> article_count_ = 0;
+  std::atomic<uint64_t> changes_ = 0; // 增量更新的次数，用于对账时检测并发修改
+  periodic_task task_;
+};
+} // namespace purecpp
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace purecpp {
+
+enum class article_state : uint8_t {
+  draft,
+  pending_review,
+  published,
+  rejected
+};
+
+inline article_state to_article_state(std::string_view status) {
+  if (status == PUBLISHED) {
+    return article_state::published;
+  }
+  if (status == PENDING_REVIEW) {
+    return article_state::pending_review;
+  }
+  if (status == REJECTED) {
+    return article_state::rejected;
+  }
+  return article_state::draft;
+}
+
+struct slug_entry {
+  uint64_t article_id;
+  uint64_t author_id;
+  article_state state;
+  bool is_deleted;
+};
+
+/**
+ * @brief slug -> 文章ID、作者ID、状态的内存索引
+ *
+ * 启动时加载所有文章(包括已删除的)，发布、审核、编辑、删除时同步更新，
+ * 评论、删除文章、加精华等接口不必再为了把slug换成文章ID查询数据库。
+ * slug固定8个字节，直接作为64位整数做哈希，用线性探测的开放寻址表保存，
+ * 键和值放在同一个数组里；文章只会软删除，表中的项也从不删除。
+ */
+class slug_index {
+public:
+  static slug_index &instance() {
+    static slug_index instance;
+    return instance;
+  }
+
+  bool init() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "slug index init failed: no db connection";
+      return false;
+    }
+
+    auto rows = conn->select(col(&articles_t::slug),
+                             col(&articles_t::article_id),
+                             col(&articles_t::author_id),
+                             col(&articles_t::status),
+                             col(&articles_t::is_deleted))
+                    .from<articles_t>()
+                    .collect();
+
+    std::unique_lock lock(mutex_);
+    slots_.assign(capacity_for(rows.size()), slot{});
+    size_ = 0;
+    for (const auto &row : rows) {
+      const auto &slug = std::get<0>(row);
+      upsert_locked(to_key(std::string_view(slug.data(), slug.size())),
+                    slug_entry{std::get<1>(row), std::get<2>(row),
+                               to_article_state(std::get<3>(row)),
+                               static_cast<bool>(std::get<4>(row))});
+    }
+    CINATRA_LOG_INFO << "slug index loaded " << size_ << " articles";
+    return true;
+  }
+
+  /**
+   * @brief 查找文章，slug不存在时返回std::nullopt
+   */
+  std::optional<slug_entry> find(std::string_view slug) const {
+    if (slug.size() != key_size) {
+      return std::nullopt;
+    }
+    uint64_t key = to_key(slug);
+    std::shared_lock lock(mutex_);
+    size_t i = find_slot_locked(key);
+    if (slots_[i].key == 0) {
+      return std::nullopt;
+    }
+    return slots_[i].entry;
+  }
+
+  /**
+   * @brief 新增文章或更新整个条目
+   */
+  void upsert(std::string_view slug, const slug_entry &entry) {
+    if (slug.size() != key_size) {
+      return;
+    }
+    std::unique_lock lock(mutex_);
+    upsert_locked(to_key(slug), entry);
+  }
+
+  /**
+   * @brief 更新文章状态(审核、编辑后重新待审核)
+   */
+  void set_state(std::string_view slug, article_state state) {
+    update(slug, [state](slug_entry &entry) { entry.state = state; });
+  }
+
+  void mark_deleted(std::string_view slug) {
+    update(slug, [](slug_entry &entry) { entry.is_deleted = true; });
+  }
+
+private:
+  slug_index() = default;
+  slug_index(const slug_index &) = delete;
+  slug_index &operator=(const slug_index &) = delete;
+
+  static constexpr size_t key_size =
+      std::tuple_size_v<decltype(articles_t::slug)>;
+  static_assert(key_size == sizeof(uint64_t));
+
+  // key为0表示空槽，slug由字母和数字组成，不会是全0
+  struct slot {
+    uint64_t key = 0;
+    slug_entry entry{};
+  };
+
+  static uint64_t to_key(std::string_view slug) {
+    uint64_t key = 0;
+    std::memcpy(&key, slug.data(), key_size);
+    return key;
+  }
+
+  // 负载因子不超过1/2，容量为2的幂
+  static size_t capacity_for(size_t n) {
+    size_t capacity = 64;
+    while (capacity < n * 2) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  size_t find_slot_locked(uint64_t key) const {
+    size_t mask = slots_.size() - 1;
+    // Fibonacci哈希，把slug各字节的差异扩散到高位
+    size_t i = ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (slots_[i].key != 0 && slots_[i].key != key) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  void upsert_locked(uint64_t key, const slug_entry &entry) {
+    if ((size_ + 1) * 2 > slots_.size()) {
+      grow_locked();
+    }
+    size_t i = find_slot_locked(key);
+    if (slots_[i].key == 0) {
+      slots_[i].key = key;
+      size_++;
+    }
+    slots_[i].entry = entry;
+  }
+
+  void grow_locked() {
+    std::vector<slot> old = std::move(slots_);
+    slots_.assign(old.size() * 2, slot{});
+    for (const auto &s : old) {
+      if (s.key != 0) {
+        slots_[find_slot_locked(s.key)] = s;
+      }
+    }
+  }
+
+  template <typename Fn> void update(std::string_view slug, Fn fn) {
+    if (slug.size() != key_size) {
+      return;
+    }
+    uint64_t key = to_key(slug);
+    std::unique_lock lock(mutex_);
+    size_t i = find_slot_locked(key);
+    if (slots_[i].key != 0) {
+      fn(slots_[i].entry);
+    }
+  }
+
+  mutable std::shared_mutex mutex_;
+  std::vector<slot> slots_ = std::vector<slot>(capacity_for(0));
+  size_t size_ = 0;
+};
+} // namespace purecpp
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cinatra.hpp>
+#include <openssl/evp.h>
+#include <zlib.h>
+
+using namespace cinatra;
+
+namespace purecpp {
+
+/**
+ * @brief gzip压缩，失败时返回空
+ */
+inline std::string gzip_compress(std::string_view data) {
+  z_stream zs{};
+  // windowBits加16输出gzip格式
+  if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return {};
+  }
+
+  std::string out;
+  out.resize(deflateBound(&zs, data.size()));
+  zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  int ret = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  if (ret != Z_STREAM_END) {
+    return {};
+  }
+  return out;
+}
+
+/**
+ * @brief 内容的强ETag：SHA-256的前32位十六进制
+ */
+inline std::string make_etag(std::string_view data) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_len = 0;
+  EVP_Digest(data.data(), data.size(), digest, &digest_len, EVP_sha256(),
+             nullptr);
+  static constexpr char hex_chars[] = "0123456789abcdef";
+  std::string etag = "\"";
+  for (unsigned int i = 0; i < 16 && i < digest_len; i++) {
+    etag.push_back(hex_chars[digest[i] >> 4]);
+    etag.push_back(hex_chars[digest[i] & 0x0F]);
+  }
+  etag.push_back('"');
+  return etag;
+}
+
+/**
+ * @brief gzip压缩内容的ETag：在原始内容的ETag后加-gz
+ *
+ * 同一资源的不同编码是不同的表示，不能共用强ETag。
+ */
+inline std::string make_gzip_etag(std::string_view etag) {
+  std::string gzip_etag(etag.substr(0, etag.size() - 1));
+  gzip_etag.append("-gz\"");
+  return gzip_etag;
+}
+
+namespace static_detail {
+inline std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+// 按逗号拆分HTTP头的值，对每一项调用fn，fn返回true时停止
+template <typename Fn> inline bool any_of_list(std::string_view value, Fn fn) {
+  while (!value.empty()) {
+    size_t comma = value.find(',');
+    if (fn(trim(value.substr(0, comma)))) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    value.remove_prefix(comma + 1);
+  }
+  return false;
+}
+} // namespace static_detail
+
+/**
+ * @brief If-None-Match是否和etag匹配
+ */
+inline bool etag_matches(std::string_view if_none_match,
+                         std::string_view etag) {
+  return static_detail::any_of_list(if_none_match, [&](std::string_view tag) {
+    if (tag.starts_with("W/")) {
+      tag.remove_prefix(2);
+    }
+    return tag == "*" || tag == etag;
+  });
+}
+
+/**
+ * @brief Accept-Encoding是否接受某种压缩格式
+ * @param coding 如"gzip"、"deflate"
+ */
+inline bool accepts_encoding(std::string_view accept_encoding,
+                             std::string_view coding) {
+  auto accepted = [&](std::string_view item) {
+    size_t semi = item.find(';');
+    auto name = static_detail::trim(item.substr(0, semi));
+    if (name != coding && name != "*") {
+      return false;
+    }
+    // q=0表示不接受
+    if (semi != std::string_view::npos) {
+      auto params = item.substr(semi + 1);
+      size_t q = params.find("q=");
+      if (q != std::string_view::npos) {
+        auto value = static_detail::trim(params.substr(q + 2));
+        value = value.substr(0, value.find(';'));
+        return value.find_first_not_of("0.") != std::string_view::npos;
+      }
+    }
+    return true;
+  };
+  return static_detail::any_of_list(accept_encoding, accepted);
+}
+
+struct static_asset {
+  std::string content;
+  std::string gzip; // gzip压缩后的内容，不值得压缩时为空
+  std::string etag;
+  std::string gzip_etag; // gzip内容的ETag，没有gzip内容时为空
+  std::string content_type;
+};
+
+// 一个URL对应的静态文件，带指纹的URL和原URL共用同一份内容
+struct static_route {
+  std::shared_ptr<const static_asset> asset;
+  std::string_view cache_control;
+};
+
+/**
+ * @brief 把html中src/href引用的js、css换成带指纹的文件名
+ * @param html 页面内容
+ * @param base_dir 页面所在目录(相对静态文件目录)，用于解析相对路径
+ * @param fingerprinted 原路径 -> 带指纹的路径，均相对静态文件目录
+ */
+inline std::string fingerprint_urls(
+    std::string_view html, const std::filesystem::path &base_dir,
+    const std::unordered_map<std::string, std::string> &fingerprinted) {
+  std::string out;
+  out.reserve(html.size());
+  size_t pos = 0;
+  while (pos < html.size()) {
+    size_t src = html.find("src=\"", pos);
+    size_t href = html.find("href=\"", pos);
+    size_t attr = std::min(src, href);
+    if (attr == std::string_view::npos) {
+      break;
+    }
+    size_t begin = html.find('"', attr) + 1;
+    size_t end = html.find('"', begin);
+    if (end == std::string_view::npos) {
+      break;
+    }
+    out.append(html.substr(pos, begin - pos));
+    pos = end;
+
+    auto value = html.substr(begin, end - begin);
+    std::string key =
+        value.starts_with('/')
+            ? std::string(value.substr(1))
+            : (base_dir / value).lexically_normal().generic_string();
+    auto it = fingerprinted.find(key);
+    if (it == fingerprinted.end()) {
+      out.append(value);
+      continue;
+    }
+    // 带指纹的文件和原文件在同一目录，只替换文件名
+    size_t dir_len = value.rfind('/') + 1; // 没有'/'时npos + 1 == 0
+    out.append(value.substr(0, dir_len));
+    out.append(it->second.substr(it->second.rfind('/') + 1));
+  }
+  out.append(html.substr(pos));
+  return out;
+}
+
+/**
+ * @brief html目录下静态文件的内存缓存
+ *
+ * 启动时把html目录(上传目录除外)下的文件全部读入内存，预先计算gzip压缩结果、
+ * ETag和Content-Type。请求时根据Accept-Encoding选择压缩或原始内容，
+ * If-None-Match匹配时返回304，不再读文件也不再压缩。gzip内容使用单独的ETag。
+ * 超过大小限制没有缓存的文件和启动后新增的文件仍从磁盘读取。
+ * js和css额外以"文件名.哈希.扩展名"的URL提供并允许浏览器永久缓存，
+ * 页面中对它们的引用在加载时替换成带指纹的URL，文件内容变化后URL随之变化。
+ * 加载后不再修改，读取无需加锁；修改静态文件后需要重启服务。
+ */
+class static_cache {
+public:
+  static static_cache &instance() {
+    static static_cache instance;
+    return instance;
+  }
+
+  /**
+   * @brief 加载目录下的静态文件
+   * @param root 静态文件目录
+   * @param skip_dir 不缓存的子目录(运行时写入的上传文件)
+   */
+  bool load(const std::filesystem::path &root, std::string_view skip_dir) {
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(root, ec), end;
+    if (ec) {
+      CINATRA_LOG_ERROR << "load static files failed: " << ec.message();
+      return false;
+    }
+
+    // 相对路径 -> 文件内容
+    std::unordered_map<std::string, static_asset> files;
+    size_t total = 0;
+    for (; it != end; it.increment(ec)) {
+      if (ec) {
+        CINATRA_LOG_ERROR << "load static files failed: " << ec.message();
+        return false;
+      }
+      auto rel =
+          std::filesystem::relative(it->path(), root, ec).generic_string();
+      if (it->is_directory() && rel == skip_dir) {
+        it.disable_recursion_pending();
+        continue;
+      }
+      if (!it->is_regular_file() || it->file_size() > max_file_size) {
+        continue;
+      }
+      if (total + it->file_size() > max_total_size) {
+        CINATRA_LOG_WARNING << "static cache full, skip " << rel;
+        continue;
+      }
+
+      std::ifstream file(it->path(), std::ios::binary);
+      if (!file) {
+        continue;
+      }
+      static_asset asset{};
+      asset.content.assign(std::istreambuf_iterator<char>(file),
+                           std::istreambuf_iterator<char>());
+      asset.content_type = std::string(get_mime_type(get_extension(rel)));
+      total += asset.content.size();
+      files.emplace(std::move(rel), std::move(asset));
+    }
+
+    // js和css加上内容哈希作为指纹
+    std::unordered_map<std::string, std::string> fingerprinted;
+    for (const auto &[rel, asset] : files) {
+      auto ext = get_extension(rel);
+      if (ext != ".js" && ext != ".css") {
+        continue;
+      }
+      auto hash = make_etag(asset.content).substr(1, 8);
+      fingerprinted[rel] = rel.substr(0, rel.size() - ext.size()) + "." +
+                           hash + std::string(ext);
+    }
+
+    for (auto &[rel, asset] : files) {
+      bool html = get_extension(rel) == ".html";
+      if (html) {
+        asset.content = fingerprint_urls(
+            asset.content, std::filesystem::path(rel).parent_path(),
+            fingerprinted);
+      }
+      asset.etag = make_etag(asset.content);
+      if (compressible(asset.content_type)) {
+        auto gzip = gzip_compress(asset.content);
+        if (!gzip.empty() && gzip.size() < asset.content.size() * 9 / 10) {
+          asset.gzip = std::move(gzip);
+          asset.gzip_etag = make_gzip_etag(asset.etag);
+        }
+      }
+
+      auto shared = std::make_shared<const static_asset>(std::move(asset));
+      // html会引用其他资源，每次都向服务器确认；其他文件缓存一小时
+      routes_["/" + rel] = static_route{
+          shared, html ? "no-cache" : "public, max-age=3600"};
+      auto fp = fingerprinted.find(rel);
+      if (fp != fingerprinted.end()) {
+        routes_["/" + fp->second] = static_route{
+            shared, "public, max-age=31536000, immutable"};
+      }
+    }
+    CINATRA_LOG_INFO << "static cache loaded " << files.size() << " files, "
+                     << fingerprinted.size() << " fingerprinted, " << total
+                     << " bytes";
+    return true;
+  }
+
+  /**
+   * @brief 按URL路径查找，如"/script/app.js"
+   */
+  const static_route *find(std::string_view path) const {
+    auto it = routes_.find(std::string(path));
+    return it == routes_.end() ? nullptr : &it->second;
+  }
+
+  std::vector<std::string> paths() const {
+    std::vector<std::string> result;
+    result.reserve(routes_.size());
+    for (const auto &[path, route] : routes_) {
+      result.push_back(path);
+    }
+    return result;
+  }
+
+  /**
+   * @brief 返回静态文件，内容直接引用缓存不复制
+   */
+  static void serve(const static_route &route, coro_http_request &req,
+                    coro_http_response &resp) {
+    respond(route, req, resp, false);
+  }
+
+  /**
+   * @brief 返回会被替换的快照，如sitemap和订阅
+   *
+   * 响应在处理函数返回后才发送，期间快照可能被替换并释放，
+   * 所以内容复制到响应中，不引用快照。
+   */
+  static void serve_copy(const static_route &route, coro_http_request &req,
+                         coro_http_response &resp) {
+    respond(route, req, resp, true);
+  }
+
+private:
+  static_cache() = default;
+  static_cache(const static_cache &) = delete;
+  static_cache &operator=(const static_cache &) = delete;
+
+  static constexpr size_t max_file_size = 8 * 1024 * 1024;
+  static constexpr size_t max_total_size = 128 * 1024 * 1024;
+
+  static void respond(const static_route &route, coro_http_request &req,
+                      coro_http_response &resp, bool copy) {
+    const auto &asset = *route.asset;
+    bool use_gzip =
+        !asset.gzip.empty() &&
+        accepts_encoding(req.get_header_value("accept-encoding"), "gzip");
+    const auto &etag = use_gzip ? asset.gzip_etag : asset.etag;
+    resp.add_header("ETag", etag);
+    resp.add_header("Cache-Control", std::string(route.cache_control));
+    if (!asset.gzip.empty()) {
+      resp.add_header("Vary", "Accept-Encoding");
+    }
+    // 只和本次返回的编码的ETag比较，缓存的另一种编码不能用于这次请求
+    if (etag_matches(req.get_header_value("if-none-match"), etag)) {
+      resp.set_status(status_type::not_modified);
+      return;
+    }
+
+    resp.add_header("Content-Type", asset.content_type);
+    if (use_gzip) {
+      resp.add_header("Content-Encoding", "gzip");
+    }
+    const auto &body = use_gzip ? asset.gzip : asset.content;
+    if (copy) {
+      resp.set_status_and_content(status_type::ok, std::string(body));
+      return;
+    }
+    resp.set_status_and_content_view(status_type::ok, body);
+  }
+
+  static bool compressible(std::string_view content_type) {
+    return content_type.starts_with("text/") ||
+           content_type.find("javascript") != std::string_view::npos ||
+           content_type.find("json") != std::string_view::npos ||
+           content_type.find("xml") != std::string_view::npos;
+  }
+
+  std::unordered_map<std::string, static_route> routes_; // URL路径 -> 文件
+};
+} // namespace purecpp
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+#include "periodic_task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace purecpp {
+
+// 某一时刻的标签目录，发布后不再修改
+struct tag_snapshot {
+  std::vector<tags_t> tags;            // 按tag_id升序
+  std::unordered_map<int, int> groups; // tag_id -> tag_group
+  std::string json; // 序列化好的tags，作为/api/v1/get_tags的data
+
+  /**
+   * @brief 标签所属的标签组，标签不存在时返回0
+   */
+  int group_of(int tag_id) const {
+    auto it = groups.find(tag_id);
+    return it == groups.end() ? 0 : it->second;
+  }
+};
+
+/**
+ * @brief 内存中的标签目录
+ *
+ * 标签很少变化，加载后生成不可变的快照，通过原子的shared_ptr发布。
+ * 读取方拿到快照后无需加锁，重新加载时整体替换，旧快照在最后一个
+ * 读取方释放后销毁。后台定期重新加载，管理员也可以通过接口立即重新加载。
+ */
+class tag_catalog {
+public:
+  using snapshot_ptr = std::shared_ptr<const tag_snapshot>;
+  using listener = std::function<void(const snapshot_ptr &)>;
+
+  static tag_catalog &instance() {
+    static tag_catalog instance;
+    return instance;
+  }
+
+  /**
+   * @brief 当前的标签目录，不会返回空指针
+   */
+  snapshot_ptr snapshot() const {
+    return snapshot_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief 从数据库加载标签并发布新的快照
+   */
+  bool reload() {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "tag catalog reload failed: no db connection";
+      return false;
+    }
+
+    auto next = std::make_shared<tag_snapshot>();
+    next->tags = conn->select(ormpp::all).from<tags_t>().collect();
+    std::sort(next->tags.begin(), next->tags.end(),
+              [](const tags_t &a, const tags_t &b) {
+                return a.tag_id < b.tag_id;
+              });
+    for (const auto &tag : next->tags) {
+      next->groups[tag.tag_id] = tag.tag_group;
+    }
+    iguana::to_json(next->tags, next->json);
+
+    // 同一时间只有一个线程发布，保证监听者按发布顺序收到快照
+    std::lock_guard lock(reload_mutex_);
+    auto prev = snapshot();
+    bool groups_changed = prev->groups != next->groups;
+    snapshot_ptr published = std::move(next);
+    snapshot_.store(published, std::memory_order_release);
+    if (groups_changed) {
+      for (const auto &fn : listeners_) {
+        fn(published);
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief 注册标签分组变化的回调，在重新加载的线程中调用
+   */
+  void on_groups_changed(listener fn) {
+    std::lock_guard lock(reload_mutex_);
+    listeners_.push_back(std::move(fn));
+  }
+
+  /**
+   * @brief 启动后台定期重新加载
+   * @param interval_seconds 重新加载间隔（秒）
+   */
+  void start(int interval_seconds) {
+    if (interval_seconds <= 0) {
+      interval_seconds = 60;
+    }
+    task_.start(std::chrono::seconds(interval_seconds), [this] { reload(); });
+  }
+
+  void stop() { task_.stop(); }
+
+private:
+  tag_catalog() {
+    auto empty = std::make_shared<tag_snapshot>();
+    empty->json = "[]";
+    snapshot_.store(std::move(empty));
+  }
+  tag_catalog(const tag_catalog &) = delete;
+  tag_catalog &operator=(const tag_catalog &) = delete;
+
+  std::atomic<snapshot_ptr> snapshot_;
+  std::mutex reload_mutex_;
+  std::vector<listener> listeners_;
+  periodic_task task_;
+};
+} // namespace purecpp
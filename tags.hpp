@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.hpp"
+#include "tag_catalog.hpp"
+#include "user_aspects.hpp"
 #include <vector>
 
 using namespace cinatra;
@@ -9,15 +11,54 @@ namespace purecpp {
 class tags {
 public:
   void get_tags(coro_http_request &req, coro_http_response &resp) {
+    // 标签列表在加载时已序列化好，这里只拼上响应的外层
+    auto snapshot = tag_catalog::instance().snapshot();
+    resp.set_status_and_content(
+        status_type::ok, make_data_raw(snapshot->json, "获取标签成功"));
+  }
+
+  /**
+   * @brief 管理员修改标签后立即重新加载标签目录
+   */
+  void reload_tags(coro_http_request &req, coro_http_response &resp) {
+    auto user_id = get_user_id_from_token(req);
+    if (user_id == 0) {
+      resp.set_status_and_content(status_type::unauthorized,
+                                  make_error("用户未登录或登录已过期"));
+      return;
+    }
+
     auto conn = connection_pool<dbng<mysql>>::instance().get();
     if (conn == nullptr) {
       set_server_internel_error(resp);
       return;
     }
-    std::vector<tags_t> vec = conn->select(ormpp::all).from<tags_t>().collect();
 
-    std::string json = make_data(vec, "获取标签成功");
-    resp.set_status_and_content(status_type::ok, std::move(json));
+    auto users_vect = conn->select(col(&users_t::role))
+                          .from<users_t>()
+                          .where(col(&users_t::id) == user_id)
+                          .collect();
+    if (users_vect.empty()) {
+      resp.set_status_and_content(status_type::bad_request,
+                                  make_error("无效的请求参数"));
+      return;
+    }
+
+    std::string role = std::get<0>(users_vect.front());
+    if (role != "admin" && role != "superadmin") {
+      resp.set_status_and_content(
+          status_type::forbidden,
+          make_error("权限不足，只有管理员可以重新加载标签"));
+      return;
+    }
+
+    if (!tag_catalog::instance().reload()) {
+      set_server_internel_error(resp);
+      return;
+    }
+
+    resp.set_status_and_content(status_type::ok,
+                                make_success("重新加载标签成功"));
   }
 };
-} // namespace purecpp
\ No newline at end of file
+} // namespace purecpp
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "slug_index.hpp"
+#include "view_counter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace purecpp {
+
+/**
+ * @brief 按近期浏览、评论和加精华排序的热门文章
+ *
+ * 每个事件给文章加上随时间指数衰减的分数，半衰期可配置。
+ * 为了不必定期衰减所有分数，分数按前向衰减记录：t时刻的事件记为
+ * weight * 2^((t - base) / half_life)，所有文章的分数同比例变化，
+ * 排序保持不变，只在指数过大时统一缩小一次。
+ * 只跟踪固定数量的文章(Space-Saving算法)：已满时替换分数最低的文章，
+ * 新文章继承它的分数，热门文章不会被挤出。取前K篇时直接从有序集合取，
+ * 不需要对文章表排序。数据只在内存中，重启后重新累计。
+ * 浏览量不在每次浏览时记录，而是在view_counter写回数据库后按批次加入，
+ * 浏览文章的路径上不需要获取这里的锁。
+ */
+class trending {
+public:
+  static constexpr double view_weight = 1.0;
+  static constexpr double comment_weight = 5.0;
+  static constexpr double featured_weight = 20.0;
+
+  static trending &instance() {
+    static trending instance;
+    return instance;
+  }
+
+  /**
+   * @brief 设置分数的半衰期并订阅浏览量的写回，需要在记录事件前调用
+   */
+  void init(int half_life_hours) {
+    if (half_life_hours <= 0) {
+      half_life_hours = 24;
+    }
+    {
+      std::lock_guard lock(mutex_);
+      half_life_ms_ = half_life_hours * 3600.0 * 1000;
+      base_ms_ = now_ms();
+    }
+    view_counter::instance().on_flush(
+        [this](const view_counter::batch &items) { add_views(items); });
+  }
+
+  void add_comment(uint64_t article_id) { add(article_id, comment_weight); }
+
+  void add_featured(uint64_t article_id) { add(article_id, featured_weight); }
+
+  /**
+   * @brief 分数最高的k篇文章ID，按分数降序
+   */
+  std::vector<uint64_t> top(size_t k) {
+    std::vector<uint64_t> ids;
+    std::lock_guard lock(mutex_);
+    ids.reserve(std::min(k, ranked_.size()));
+    for (auto it = ranked_.rbegin(); it != ranked_.rend() && ids.size() < k;
+         ++it) {
+      ids.push_back(it->second);
+    }
+    return ids;
+  }
+
+private:
+  trending() = default;
+  trending(const trending &) = delete;
+  trending &operator=(const trending &) = delete;
+
+  // 跟踪的文章数，远大于页面展示的数量
+  static constexpr size_t capacity = 1024;
+  // 2^64倍时缩小分数，避免double溢出
+  static constexpr double max_exponent = 64;
+
+  static uint64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void add(uint64_t article_id, double weight) {
+    std::lock_guard lock(mutex_);
+    add_locked(article_id, weight * scale_locked());
+  }
+
+  // 一批写回的浏览量只加一次锁，只统计已发布的文章
+  void add_views(const view_counter::batch &items) {
+    std::vector<std::pair<uint64_t, uint32_t>> views;
+    views.reserve(items.size());
+    for (const auto &[slug, n] : items) {
+      auto entry = slug_index::instance().find(slug);
+      if (entry && entry->state == article_state::published &&
+          !entry->is_deleted) {
+        views.emplace_back(entry->article_id, n);
+      }
+    }
+    if (views.empty()) {
+      return;
+    }
+
+    std::lock_guard lock(mutex_);
+    double scale = scale_locked();
+    for (const auto &[article_id, n] : views) {
+      add_locked(article_id, n * view_weight * scale);
+    }
+  }
+
+  // 当前时刻事件的前向衰减系数，指数过大时先缩小所有分数
+  double scale_locked() {
+    uint64_t now = now_ms();
+    double exponent = (static_cast<double>(now) - base_ms_) / half_life_ms_;
+    if (exponent > max_exponent) {
+      rescale_locked(now);
+      exponent = 0;
+    }
+    return std::exp2(exponent);
+  }
+
+  void add_locked(uint64_t article_id, double delta) {
+    auto it = scores_.find(article_id);
+    if (it != scores_.end()) {
+      ranked_.erase({it->second, article_id});
+      it->second += delta;
+      ranked_.emplace(it->second, article_id);
+      return;
+    }
+
+    double score = delta;
+    if (scores_.size() >= capacity) {
+      auto min = ranked_.begin();
+      score += min->first;
+      scores_.erase(min->second);
+      ranked_.erase(min);
+    }
+    scores_.emplace(article_id, score);
+    ranked_.emplace(score, article_id);
+  }
+
+  // 把基准时间移到now，所有分数按同一比例缩小
+  void rescale_locked(uint64_t now) {
+    double factor =
+        std::exp2(-(static_cast<double>(now) - base_ms_) / half_life_ms_);
+    ranked_.clear();
+    for (auto &[article_id, score] : scores_) {
+      score *= factor;
+      ranked_.emplace(score, article_id);
+    }
+    base_ms_ = static_cast<double>(now);
+  }
+
+  std::mutex mutex_;
+  double half_life_ms_ = 24 * 3600.0 * 1000;
+  double base_ms_ = static_cast<double>(now_ms());
+  std::unordered_map<uint64_t, double> scores_;  // article_id -> 分数
+  std::set<std::pair<double, uint64_t>> ranked_; // (分数, article_id)
+};
+} // namespace purecpp
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "common.hpp"
+#include "error_info.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <cinatra.hpp>
+#include <openssl/evp.h>
+
+using namespace cinatra;
+
+namespace purecpp {
+
+/**
+ * @brief 请求体是否为二进制上传(chunked或application/octet-stream)，
+ * 否则为JSON里带base64数据的旧格式
+ */
+inline bool is_binary_upload(coro_http_request &req) {
+  auto type = req.get_content_type();
+  return type == content_type::chunked || type == content_type::octet_stream;
+}
+
+/**
+ * @brief 根据文件开头的字节检查内容和扩展名是否一致
+ * @param ext 小写的扩展名，带点号
+ * @param head 文件开头的字节，文件较小时可能不足16字节
+ */
+inline bool match_file_magic(std::string_view ext, std::string_view head) {
+  using namespace std::string_view_literals;
+  if (ext == ".png") {
+    return head.starts_with("\x89PNG\r\n\x1a\n"sv);
+  }
+  if (ext == ".jpg" || ext == ".jpeg") {
+    return head.starts_with("\xff\xd8\xff"sv);
+  }
+  if (ext == ".gif") {
+    return head.starts_with("GIF87a"sv) || head.starts_with("GIF89a"sv);
+  }
+  if (ext == ".pdf") {
+    return head.starts_with("%PDF-"sv);
+  }
+  if (ext == ".txt") {
+    return !head.empty() && head.find('\0') == std::string_view::npos;
+  }
+  return false;
+}
+
+/**
+ * @brief 非图片文件中不允许出现的脚本和命令特征
+ */
+inline constexpr std::array<std::string_view, 17> DANGEROUS_PATTERNS = {
+    "<?php",   "<?=",     "eval(",   "base64_decode(", "shell_exec(",
+    "system(", "exec(",   "popen(",  "passthru(",      "/bin/sh",
+    "/bin/bash", "cmd.exe", "`",     "&&",             "||",
+    ";",       "|"};
+
+inline bool is_image_ext(std::string_view ext) {
+  return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".gif";
+}
+
+/**
+ * @brief 上传文件的写入端
+ *
+ * 数据边到达边写入上传目录下的临时文件，写入时检查大小和文件头并计算SHA-256，
+ * 非图片文件还逐段检查危险内容，
+ * 全部写完后commit把临时文件重命名为"哈希前两位/哈希.扩展名"，
+ * 内容相同的文件已经存在时直接复用，删除临时文件。
+ * 同一文件系统内的重命名是原子的，不会出现只写了一半的文件。
+ * 未commit时析构会删除临时文件。
+ */
+class upload_sink {
+public:
+  /**
+   * @param dir 上传目录
+   * @param ext 小写的扩展名，带点号，用于检查文件头
+   * @param max_size 文件大小上限（字节）
+   */
+  upload_sink(std::filesystem::path dir, std::string ext, size_t max_size)
+      : dir_(std::move(dir)), ext_(std::move(ext)), max_size_(max_size),
+        scan_(!is_image_ext(ext_)) {}
+
+  ~upload_sink() {
+    discard();
+    EVP_MD_CTX_free(md_ctx_);
+  }
+
+  upload_sink(const upload_sink &) = delete;
+  upload_sink &operator=(const upload_sink &) = delete;
+
+  bool open() {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+      CINATRA_LOG_ERROR << "create upload dir failed: " << ec.message();
+      return false;
+    }
+
+    md_ctx_ = EVP_MD_CTX_new();
+    if (md_ctx_ == nullptr ||
+        EVP_DigestInit_ex(md_ctx_, EVP_sha256(), nullptr) != 1) {
+      CINATRA_LOG_ERROR << "init sha256 failed";
+      return false;
+    }
+
+    static std::atomic<uint64_t> seq = 0;
+    tmp_path_ =
+        dir_ / (".upload_" + std::to_string(seq.fetch_add(1)) + ".part");
+    if (!file_.open(tmp_path_.string(),
+                    std::ios::out | std::ios::binary | std::ios::trunc)) {
+      CINATRA_LOG_ERROR << "open upload temp file failed: " << tmp_path_;
+      return false;
+    }
+    opened_ = true;
+    return true;
+  }
+
+  /**
+   * @brief 写入一段数据
+   * @return 出错时返回错误信息，成功返回空
+   */
+  async_simple::coro::Lazy<std::string_view> write(std::string_view data) {
+    size_ += data.size();
+    if (size_ > max_size_) {
+      co_return PURECPP_ERROR_UPLOAD_FILE_SIZE_EXCEED;
+    }
+
+    // 攒够文件头后检查一次
+    if (head_.size() < head_size) {
+      head_.append(data.substr(0, head_size - head_.size()));
+      if (head_.size() == head_size && !match_file_magic(ext_, head_)) {
+        co_return PURECPP_ERROR_UPLOAD_FILE_TYPE_MISMATCH;
+      }
+    }
+
+    if (scan_ && contains_dangerous_content(data)) {
+      co_return PURECPP_ERROR_UPLOAD_FILE_INVALID_CONTENT;
+    }
+
+    if (data.empty()) {
+      co_return std::string_view{};
+    }
+    auto ec = co_await file_.async_write(data);
+    if (ec) {
+      CINATRA_LOG_ERROR << "write upload temp file failed: " << ec.message();
+      co_return PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED;
+    }
+    EVP_DigestUpdate(md_ctx_, data.data(), data.size());
+    co_return std::string_view{};
+  }
+
+  /**
+   * @brief 所有数据写完后按内容哈希保存
+   * @return 出错时返回错误信息，成功返回空
+   */
+  std::string_view commit() {
+    if (size_ == 0) {
+      return PURECPP_ERROR_UPLOAD_FILE_EMPTY;
+    }
+    if (head_.size() < head_size && !match_file_magic(ext_, head_)) {
+      return PURECPP_ERROR_UPLOAD_FILE_TYPE_MISMATCH;
+    }
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    if (EVP_DigestFinal_ex(md_ctx_, digest, &digest_len) != 1) {
+      CINATRA_LOG_ERROR << "finish sha256 failed";
+      return PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED;
+    }
+    static constexpr char hex_chars[] = "0123456789abcdef";
+    hash_.clear();
+    for (unsigned int i = 0; i < digest_len; i++) {
+      hash_.push_back(hex_chars[digest[i] >> 4]);
+      hash_.push_back(hex_chars[digest[i] & 0x0F]);
+    }
+    name_ = hash_.substr(0, 2) + "/" + hash_ + ext_;
+
+    file_.close();
+    std::error_code ec;
+    auto path = dir_ / name_;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (!ec && std::filesystem::exists(path, ec)) {
+      // 内容相同的文件已经存在
+      discard();
+      return {};
+    }
+    std::filesystem::rename(tmp_path_, path, ec);
+    if (ec) {
+      CINATRA_LOG_ERROR << "rename upload file failed: " << ec.message();
+      return PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED;
+    }
+    opened_ = false;
+    return {};
+  }
+
+  size_t size() const { return size_; }
+
+  // commit成功后有效：SHA-256的十六进制
+  const std::string &hash() const { return hash_; }
+
+  // commit成功后有效：相对上传目录的路径
+  const std::string &name() const { return name_; }
+
+  const std::string &ext() const { return ext_; }
+
+private:
+  static constexpr size_t head_size = 16;
+
+  // 在上一段的末尾加上这一段中查找，跨段的特征也能发现
+  bool contains_dangerous_content(std::string_view data) {
+    // 最长的特征"base64_decode("少一个字节
+    static constexpr size_t keep_size = 13;
+    scan_tail_.append(data);
+    for (auto pattern : DANGEROUS_PATTERNS) {
+      if (scan_tail_.find(pattern) != std::string::npos) {
+        return true;
+      }
+    }
+    if (scan_tail_.size() > keep_size) {
+      scan_tail_.erase(0, scan_tail_.size() - keep_size);
+    }
+    return false;
+  }
+
+  void discard() {
+    if (!opened_) {
+      return;
+    }
+    file_.close();
+    std::error_code ec;
+    std::filesystem::remove(tmp_path_, ec);
+    opened_ = false;
+  }
+
+  std::filesystem::path dir_;
+  std::string ext_;
+  size_t max_size_;
+  bool scan_; // 是否检查危险内容
+  std::filesystem::path tmp_path_;
+  coro_io::coro_file file_{};
+  EVP_MD_CTX *md_ctx_ = nullptr;
+  std::string hash_;
+  std::string name_;
+  bool opened_ = false;
+  size_t size_ = 0;
+  std::string head_;      // 文件开头的字节，用于检查文件类型
+  std::string scan_tail_; // 上一段末尾的字节，用于检查危险内容
+};
+
+/**
+ * @brief 上传失败的响应，请求体可能没有读完，不再复用连接
+ */
+inline void set_upload_error(coro_http_response &resp, std::string_view err) {
+  auto status = err == PURECPP_ERROR_UPLOAD_FILE_SAVE_FAILED
+                    ? status_type::internal_server_error
+                    : status_type::bad_request;
+  resp.set_keepalive(false);
+  resp.set_status_and_content(status, make_error(err));
+}
+
+/**
+ * @brief 把二进制请求体写入sink
+ *
+ * chunked请求逐块读取，内存占用只和单个块的大小有关；
+ * 带Content-Length的请求体在调用处理函数前已经由框架整个读入内存，
+ * 大小上限要等写入时才能检查，大文件应使用chunked上传。
+ * @return 出错时返回错误信息，成功返回空
+ */
+inline async_simple::coro::Lazy<std::string_view>
+receive_upload(coro_http_request &req, upload_sink &sink) {
+  if (req.get_content_type() != content_type::chunked) {
+    co_return co_await sink.write(req.get_body());
+  }
+
+  while (true) {
+    auto result = co_await req.get_conn()->read_chunked();
+    if (result.ec) {
+      co_return PURECPP_ERROR_UPLOAD_FILE_READ_FAILED;
+    }
+    if (result.eof) {
+      break;
+    }
+    auto err = co_await sink.write(result.data);
+    if (!err.empty()) {
+      co_return err;
+    }
+  }
+  co_return std::string_view{};
+}
+} // namespace purecpp
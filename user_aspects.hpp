@@ -3,7 +3,10 @@
 #include "entity.hpp"
 #include "error_info.hpp"
 #include "jwt_token.hpp"
+#include "markdown.hpp"
 #include "rate_limiter.hpp"
+#include "request_data.hpp"
+#include "upload_stream.hpp"
 #include "user_dto.hpp"
 #include <any>
 #include <chrono>
@@ -53,14 +56,14 @@ struct check_register_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
 
 struct check_cpp_answer {
   bool before(coro_http_request &req, coro_http_response &res) {
-    register_info info = std::any_cast<register_info>(req.get_user_data());
+    register_info info = get_request_data<register_info>(req);
     bool r = cpp_answers[info.question_index] == info.cpp_answer;
 
     if (!r) {
@@ -72,43 +75,9 @@ struct check_cpp_answer {
   }
 };
 
-std::string cleanup_markdown(const std::string &markdown_text) {
-  std::string text = markdown_text;
-
-  // 1. 清理链接和图片 (保留链接文本)
-  // 匹配 [text](url) 或 ![text](url)
-  text = std::regex_replace(text, std::regex("!\\[(.*?)\\]\\(.*?\\)"),
-                            "$1"); // 图片
-  text = std::regex_replace(text, std::regex("\\[(.*?)\\]\\(.*?\\)"),
-                            "$1"); // 链接
-
-  // 2. 清理粗体和斜体 (**bold** or *italic*)
-  // 匹配 **...** 和 *...*
-  text = std::regex_replace(text, std::regex("(\\*\\*|__)(.*?)\\1"), "$2");
-  text = std::regex_replace(text, std::regex("(\\*|_)(.*?)\\1"), "$2");
-
-  // 3. 清理代码块和行内代码 (```code``` or `code`)
-  text = std::regex_replace(text, std::regex("```[\\s\\S]*?```"),
-                            "");                                // 移除代码块
-  text = std::regex_replace(text, std::regex("`(.*?)`"), "$1"); // 行内代码
-
-  // 4. 清理标题 (# H1, ## H2, etc.)
-  text = std::regex_replace(text, std::regex("^#+\\s*"), "");
-
-  // 5. 清理列表和引用 (> quote)
-  text = std::regex_replace(text, std::regex("^[*-+]\\s"), ""); // 列表
-  text = std::regex_replace(text, std::regex("^>\\s"), "");     // 引用
-
-  // 6. 最终清理多余的换行和空格
-  // 替换多个换行符为一个空格（将段落连起来）
-  text = std::regex_replace(text, std::regex("\\n+"), " ");
-
-  return text;
-}
-
 struct check_user_name {
   bool before(coro_http_request &req, coro_http_response &res) {
-    register_info info = std::any_cast<register_info>(req.get_user_data());
+    register_info info = get_request_data<register_info>(req);
     if (info.username.empty() || info.username.size() > 20) {
       res.set_status_and_content(status_type::bad_request,
                                  make_error("用户名长度非法应改为1-20。"));
@@ -145,7 +114,7 @@ std::pair<bool, std::string> validate_email_format(std::string_view email) {
 
 struct check_email {
   bool before(coro_http_request &req, coro_http_response &res) {
-    register_info info = std::any_cast<register_info>(req.get_user_data());
+    register_info info = get_request_data<register_info>(req);
     auto [valid, error_msg] = validate_email_format(info.email);
     if (!valid) {
       res.set_status_and_content(status_type::bad_request,
@@ -189,7 +158,7 @@ validate_password_complexity(const std::string &password) {
 
 struct check_password {
   bool before(coro_http_request &req, coro_http_response &res) {
-    register_info info = std::any_cast<register_info>(req.get_user_data());
+    register_info info = get_request_data<register_info>(req);
     auto [valid, error_msg] = validate_password_complexity(info.password);
     if (!valid) {
       res.set_status_and_content(status_type::bad_request,
@@ -202,7 +171,7 @@ struct check_password {
 
 struct check_user_exists {
   bool before(coro_http_request &req, coro_http_response &res) {
-    register_info info = std::any_cast<register_info>(req.get_user_data());
+    register_info info = get_request_data<register_info>(req);
 
     auto conn = connection_pool<dbng<mysql>>::instance().get();
     if (conn == nullptr) {
@@ -286,7 +255,7 @@ struct check_login_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -317,7 +286,7 @@ struct check_logout_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -373,10 +342,8 @@ struct check_token {
                                  make_error(error_msg));
       return false;
     }
-    // 将token信息保存到切面中
-    std::string payload;
-    iguana::to_json(info, payload);
-    req.params_["user_token"] = payload;
+    // 将token信息保存到请求中
+    set_token_info(req, *info);
     return true;
   }
 };
@@ -411,7 +378,7 @@ struct check_change_password_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -429,21 +396,27 @@ struct upload_file_info {
 
 struct check_upload_file {
   bool before(coro_http_request &req, coro_http_response &res) {
-    auto body = req.get_body();
-    if (body.empty()) {
-      res.set_status_and_content(status_type::bad_request,
-                                 make_error(PURECPP_ERROR_UPLOAD_FILE_EMPTY));
-      return false;
-    }
-
     upload_file_info info{};
-    std::error_code ec;
-    iguana::from_json(info, body, ec);
-    if (ec) {
-      res.set_status_and_content(
-          status_type::bad_request,
-          make_error(PURECPP_ERROR_UPLOAD_FILE_JSON_INVALID));
-      return false;
+    // 二进制上传时文件名在查询参数中，文件内容由处理函数边读边写
+    bool binary = is_binary_upload(req);
+    if (binary) {
+      info.filename = req.get_query_value("filename");
+    } else {
+      auto body = req.get_body();
+      if (body.empty()) {
+        res.set_status_and_content(status_type::bad_request,
+                                   make_error(PURECPP_ERROR_UPLOAD_FILE_EMPTY));
+        return false;
+      }
+
+      std::error_code ec;
+      iguana::from_json(info, body, ec);
+      if (ec) {
+        res.set_status_and_content(
+            status_type::bad_request,
+            make_error(PURECPP_ERROR_UPLOAD_FILE_JSON_INVALID));
+        return false;
+      }
     }
 
     // if (info.file_data.size() > MAX_FILE_SIZE) {
@@ -463,50 +436,15 @@ struct check_upload_file {
       return false;
     }
 
-    if (contains_dangerous_content(info.file_data, ext)) {
-      res.set_status_and_content(
-          status_type::bad_request,
-          make_error(PURECPP_ERROR_UPLOAD_FILE_INVALID_CONTENT));
-      return false;
-    }
-
-    req.set_user_data(info);
+    // 危险内容由upload_sink在写入解码后的数据时检查
+    set_request_data(req, info);
     return true;
   }
-
-  bool contains_dangerous_content(std::string_view content,
-                                  std::string_view ext) {
-    // 对于文本文件，检查危险代码
-    if (ext == "txt" || ext == "pdf") {
-      // 防止 PHP 代码注入
-      if (content.find("<?php") != std::string::npos ||
-          content.find("<?=") != std::string::npos ||
-          content.find("eval(") != std::string::npos ||
-          content.find("base64_decode(") != std::string::npos) {
-        return true;
-      }
-    }
-
-    // 防止 Web Shell 特征
-    std::vector<std::string> dangerousPatterns = {
-        "system(", "exec(",     "popen(", "shell_exec(", "passthru(",
-        "`",       "&&",        "||",     ";",           "|",
-        "/bin/sh", "/bin/bash", "cmd.exe"};
-
-    for (const auto &pattern : dangerousPatterns) {
-      if (content.find(pattern) != std::string::npos) {
-        return true;
-      }
-    }
-
-    return false;
-  }
 };
 
 struct check_new_password {
   bool before(coro_http_request &req, coro_http_response &res) {
-    change_password_info info =
-        std::any_cast<change_password_info>(req.get_user_data());
+    change_password_info info = get_request_data<change_password_info>(req);
 
     // 验证新密码复杂度
     auto [valid, error_msg] = validate_password_complexity(info.new_password);
@@ -562,7 +500,7 @@ struct check_forgot_password_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -596,7 +534,7 @@ struct check_reset_password_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -604,8 +542,7 @@ struct check_reset_password_input {
 // 重置密码时的密码验证
 struct check_reset_password {
   bool before(coro_http_request &req, coro_http_response &res) {
-    reset_password_info info =
-        std::any_cast<reset_password_info>(req.get_user_data());
+    reset_password_info info = get_request_data<reset_password_info>(req);
 
     // 验证新密码复杂度
     auto [valid, error_msg] = validate_password_complexity(info.new_password);
@@ -709,7 +646,7 @@ struct check_edit_article {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -740,7 +677,7 @@ struct check_verify_email_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -771,7 +708,7 @@ struct check_resend_verification_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -813,7 +750,7 @@ struct check_refresh_token_input {
       return false;
     }
 
-    req.set_user_data(info);
+    set_request_data(req, info);
     return true;
   }
 };
@@ -2,7 +2,9 @@
 
 #include "common.hpp"
 #include "config.hpp"
+#include "count_cache.hpp"
 #include "entity.hpp"
+#include "page_cursor.hpp"
 #include <cinatra.hpp>
 
 using namespace cinatra;
@@ -332,6 +334,7 @@ public:
 
     // 提交事务
     conn->commit();
+    count_cache::instance().invalidate(count_keys::experience(user_id));
     return true;
   }
 
@@ -404,6 +407,7 @@ public:
 
     // 提交事务
     conn->commit();
+    count_cache::instance().invalidate(count_keys::experience(user_id));
     return true;
   }
 
@@ -653,6 +657,7 @@ public:
     int page_size = 20;
     auto page_str = req.get_query_value("page");
     auto page_size_str = req.get_query_value("page_size");
+    auto cursor_str = req.get_query_value("cursor");
 
     if (!page_str.empty()) {
       page = std::stoi(std::string(page_str));
@@ -668,23 +673,47 @@ public:
       return;
     }
 
-    // 计算总记录数
-    auto total_count =
-        conn->select(count(col(&user_experience_detail_t::id)))
-            .from<user_experience_detail_t>()
-            .where(col(&user_experience_detail_t::user_id).param())
-            .collect(user_id);
+    auto where_cond = col(&user_experience_detail_t::user_id).param();
 
-    // 查询分页数据
+    // 计算总记录数，游标分页时不再重复计算
+    count_result total{};
     int offset = (page - 1) * page_size;
+    if (cursor_str.empty()) {
+      total = count_cache::instance().get(
+          count_keys::experience(user_id), [&]() -> std::optional<size_t> {
+            size_t n =
+                conn->select(count(col(&user_experience_detail_t::id)))
+                    .from<user_experience_detail_t>()
+                    .where(where_cond)
+                    .collect(user_id);
+            return n;
+          });
+    } else {
+      auto cursor = decode_cursor(cursor_str);
+      if (!cursor) {
+        resp.set_status_and_content(status_type::bad_request,
+                                    make_error("无效的分页游标"));
+        return;
+      }
+      // 按记录ID排序，ID唯一，从上一页最后一条之后继续不会重复或遗漏
+      where_cond =
+          where_cond && col(&user_experience_detail_t::id) < cursor->id;
+      offset = 0;
+    }
+
+    // 查询分页数据，多取一条用于判断是否还有下一页
     auto transactions =
         conn->select(ormpp::all)
             .from<user_experience_detail_t>()
-            .where(col(&user_experience_detail_t::user_id).param())
-            .order_by(col(&user_experience_detail_t::created_at).desc())
-            .limit(page_size)
+            .where(where_cond)
+            .order_by(col(&user_experience_detail_t::id).desc())
+            .limit(page_size + 1)
             .offset(offset)
             .collect(user_id);
+    auto next_cursor = take_page(
+        transactions, page_size, [](const user_experience_detail_t &t) {
+          return page_cursor{0, t.created_at, t.id};
+        });
 
     // 构建响应数据
     std::vector<experience_transaction_info> transaction_infos;
@@ -702,12 +731,14 @@ public:
 
     experience_transactions_resp resp_data{.transactions = transaction_infos,
                                            .total_count =
-                                               static_cast<int>(total_count),
+                                               static_cast<int>(total.count),
                                            .current_page = page,
                                            .page_size = page_size};
 
-    resp.set_status_and_content(status_type::ok,
-                                make_data(resp_data, "获取经验值交易记录成功"));
+    resp.set_status_and_content(
+        status_type::ok, make_data(resp_data, "获取经验值交易记录成功",
+                                   static_cast<int>(total.count),
+                                   std::move(next_cursor), total.estimated));
   }
 
   /**
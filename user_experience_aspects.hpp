@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "entity.hpp"
+#include "request_data.hpp"
 #include "user_dto.hpp"
 #include "user_experience.hpp"
 #include <cinatra.hpp>
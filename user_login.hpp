@@ -23,7 +23,7 @@ public:
    */
   void handle_login(coro_http_request &req, coro_http_response &resp) {
     // 移除可能导致崩溃的全局语言环境设置
-    login_info info = std::any_cast<login_info>(req.get_user_data());
+    login_info info = get_request_data<login_info>(req);
 
     // 查询数据库
     auto conn = connection_pool<dbng<mysql>>::instance().get();
@@ -159,7 +159,7 @@ public:
     try {
       // 从请求中获取刷新令牌信息
       refresh_token_request refresh_info =
-          std::any_cast<refresh_token_request>(req.get_user_data());
+          get_request_data<refresh_token_request>(req);
 
       // 刷新token，传入user_id进行校验
       token_response new_token_resp = refresh_access_token(
@@ -194,7 +194,7 @@ public:
    */
   void handle_logout(cinatra::coro_http_request &req,
                      cinatra::coro_http_response &resp) {
-    logout_info info = std::any_cast<logout_info>(req.get_user_data());
+    logout_info info = get_request_data<logout_info>(req);
     // 从请求头获取令牌
     std::string token;
     auto headers = req.get_headers();
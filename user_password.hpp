@@ -20,8 +20,7 @@ public:
    */
   void handle_change_password(coro_http_request &req,
                               coro_http_response &resp) {
-    change_password_info info =
-        std::any_cast<change_password_info>(req.get_user_data());
+    change_password_info info = get_request_data<change_password_info>(req);
 
     // 查询数据库
     auto conn = connection_pool<dbng<mysql>>::instance().get();
@@ -71,8 +70,7 @@ public:
   // 处理忘记密码请求
   async_simple::coro::Lazy<void>
   handle_forgot_password(coro_http_request &req, coro_http_response &resp) {
-    forgot_password_info info =
-        std::any_cast<forgot_password_info>(req.get_user_data());
+    forgot_password_info info = get_request_data<forgot_password_info>(req);
 
     // 查询数据库
     auto conn = connection_pool<dbng<mysql>>::instance().get();
@@ -144,8 +142,7 @@ public:
 
   // 处理密码重置请求
   void handle_reset_password(coro_http_request &req, coro_http_response &resp) {
-    reset_password_info info =
-        std::any_cast<reset_password_info>(req.get_user_data());
+    reset_password_info info = get_request_data<reset_password_info>(req);
 
     // 查询数据库
     auto conn = connection_pool<dbng<mysql>>::instance().get();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "blob_store.hpp"
 #include "entity.hpp"
 #include "user_aspects.hpp"
 
@@ -186,31 +187,40 @@ public:
   /**
    * @brief 处理用户头像上传
    */
-  void upload_avatar(coro_http_request &req, coro_http_response &resp) {
+  async_simple::coro::Lazy<void> upload_avatar(coro_http_request &req,
+                                               coro_http_response &resp) {
     try {
-      // 获取请求体
-      auto body = req.get_body();
-
       avatar_upload_request upload_req;
-      std::error_code ec;
-      iguana::from_json(upload_req, body, ec);
-      if (ec) {
-        resp.set_status_and_content(status_type::bad_request,
-                                    make_error(ec.message()));
-        return;
+      bool binary = is_binary_upload(req);
+      if (binary) {
+        // 二进制上传：文件名在查询参数中，用户ID取自token
+        upload_req.user_id = get_user_id_from_token(req);
+        upload_req.filename = req.get_query_value("filename");
+      } else {
+        // 获取请求体
+        auto body = req.get_body();
+
+        std::error_code ec;
+        iguana::from_json(upload_req, body, ec);
+        if (ec) {
+          resp.set_status_and_content(status_type::bad_request,
+                                      make_error(ec.message()));
+          co_return;
+        }
       }
 
       // 验证请求参数
       if (upload_req.user_id == 0) {
         resp.set_status_and_content(status_type::bad_request,
                                     make_error("用户ID不能为空"));
-        return;
+        co_return;
       }
 
-      if (upload_req.avatar_data.empty() || upload_req.filename.empty()) {
+      if ((!binary && upload_req.avatar_data.empty()) ||
+          upload_req.filename.empty()) {
         resp.set_status_and_content(status_type::bad_request,
                                     make_error("没有找到上传的头像文件"));
-        return;
+        co_return;
       }
 
       // 检查文件类型
@@ -220,57 +230,50 @@ public:
         resp.set_status_and_content(
             status_type::bad_request,
             make_error("只支持JPG、PNG、GIF格式的图片"));
-        return;
-      }
-
-      // 解码base64图片数据
-      auto opt_avatar_data = cinatra::base64_decode(upload_req.avatar_data);
-      if (!opt_avatar_data.has_value()) {
-        resp.set_status_and_content(status_type::bad_request,
-                                    make_error("base64图片数据解码失败"));
-        return;
+        co_return;
       }
 
-      std::string &avatar_data = opt_avatar_data.value();
-      // 检查文件大小（2MB限制）
+      // 先写入临时文件，检查通过后按内容哈希保存（512KB限制）
       const size_t MAX_SIZE = 512 * 1024;
-      if (avatar_data.length() > MAX_SIZE) {
-        resp.set_status_and_content(status_type::bad_request,
-                                    make_error("图片大小不能超过512KB"));
-        return;
+      auto sink = blob_store::make_sink("." + ext, MAX_SIZE);
+      if (!sink.open()) {
+        resp.set_status_and_content(status_type::internal_server_error,
+                                    make_error("保存文件失败"));
+        co_return;
       }
 
-      // 确保uploads目录存在
-      std::filesystem::path upload_dir = "html/uploads/avatars";
-      if (!std::filesystem::exists(upload_dir)) {
-        std::filesystem::create_directories(upload_dir);
+      std::string_view err;
+      if (binary) {
+        err = co_await receive_upload(req, sink);
+      } else {
+        // 解码base64图片数据
+        auto opt_avatar_data = cinatra::base64_decode(upload_req.avatar_data);
+        if (!opt_avatar_data.has_value()) {
+          resp.set_status_and_content(status_type::bad_request,
+                                      make_error("base64图片数据解码失败"));
+          co_return;
+        }
+        err = co_await sink.write(opt_avatar_data.value());
       }
-
-      // 生成唯一文件名
-      std::string unique_filename =
-          "avatar_" + std::to_string(upload_req.user_id) + "_" +
-          std::to_string(get_timestamp_milliseconds()) + "." + ext;
-      std::filesystem::path file_path = upload_dir / unique_filename;
-
-      // 保存文件
-      std::ofstream out_file(file_path, std::ios::binary);
-      if (!out_file) {
-        resp.set_status_and_content(status_type::internal_server_error,
-                                    make_error("保存文件失败"));
-        return;
+      if (err.empty()) {
+        err = blob_store::instance().commit(sink);
+      }
+      if (err == PURECPP_ERROR_UPLOAD_FILE_SIZE_EXCEED) {
+        err = "图片大小不能超过512KB";
+      }
+      if (!err.empty()) {
+        set_upload_error(resp, err);
+        co_return;
       }
-      out_file.write(reinterpret_cast<const char *>(avatar_data.data()),
-                     avatar_data.size());
-      out_file.close();
 
       // 生成文件URL
-      std::string file_url = "/uploads/avatars/" + unique_filename;
+      std::string file_url = blob_store::url_of(sink);
 
       // 更新用户的avatar字段
       auto conn = connection_pool<dbng<mysql>>::instance().get();
       if (conn == nullptr) {
         set_server_internel_error(resp);
-        return;
+        co_return;
       }
 
       // 获取现有用户信息
@@ -282,19 +285,24 @@ public:
       if (users.empty()) {
         resp.set_status_and_content(status_type::bad_request,
                                     make_error("用户不存在"));
-        return;
+        co_return;
       }
 
       users_t update_user;
       update_user.avatar = file_url;
 
-      // 更新数据库
+      // 头像和上传文件引用在同一个事务中更新
+      conn->begin();
       if (conn->update_some<&users_t::avatar>(
-              update_user, "id=" + std::to_string(upload_req.user_id)) != 1) {
+              update_user, "id=" + std::to_string(upload_req.user_id)) != 1 ||
+          !blob_store::write_refs(*conn, blob_owner::avatar, upload_req.user_id,
+                                  file_url)) {
+        conn->rollback();
         resp.set_status_and_content(status_type::internal_server_error,
                                     make_error("更新用户头像失败"));
-        return;
+        co_return;
       }
+      conn->commit();
 
       // 构建响应
       struct upload_response {
@@ -304,17 +312,17 @@ public:
 
       upload_response data;
       data.url = file_url;
-      data.filename = unique_filename;
+      data.filename = sink.hash() + sink.ext();
 
       std::string json = make_data(data, "头像上传成功");
       resp.set_status_and_content(status_type::ok, std::move(json));
-      return;
+      co_return;
     } catch (const std::exception &e) {
       CINATRA_LOG_ERROR << "头像上传失败: " << e.what();
       resp.set_status_and_content(
           status_type::internal_server_error,
           make_error(std::string("头像上传失败: ") + e.what()));
-      return;
+      co_return;
     }
   }
 
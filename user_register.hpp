@@ -3,6 +3,7 @@
 #include "common.hpp"
 #include "email_verify.hpp"
 #include "md5.hpp"
+#include "site_stats.hpp"
 #include "user_aspects.hpp"
 #include "user_experience.hpp"
 #include <cinatra/smtp_client.hpp>
@@ -43,7 +44,7 @@ public:
   // 处理用户注册请求（改为异步方法）
   async_simple::coro::Lazy<void> handle_register(coro_http_request &req,
                                                  coro_http_response &resp) {
-    register_info info = std::any_cast<register_info>(req.get_user_data());
+    register_info info = get_request_data<register_info>(req);
     const auto &cfg = purecpp_config::get_instance().user_cfg_;
 
     // save to temporary database first
@@ -121,8 +122,7 @@ public:
   // 处理邮箱验证请求
   static void handle_verify_email(coro_http_request &req,
                                   coro_http_response &resp) {
-    verify_email_info info =
-        std::any_cast<verify_email_info>(req.get_user_data());
+    verify_email_info info = get_request_data<verify_email_info>(req);
 
     auto conn = connection_pool<dbng<mysql>>::instance().get();
     if (conn == nullptr) {
@@ -207,6 +207,7 @@ public:
 
     // 提交事务
     conn->commit();
+    site_stats::instance().add_users(1);
 
     // 返回成功响应
     std::string json = make_success("邮箱验证成功！");
@@ -217,7 +218,7 @@ public:
   static async_simple::coro::Lazy<void>
   handle_resend_verify_email(coro_http_request &req, coro_http_response &resp) {
     resend_verify_email_info info =
-        std::any_cast<resend_verify_email_info>(req.get_user_data());
+        get_request_data<resend_verify_email_info>(req);
 
     // 查询数据库中是否已存在该邮箱的用户，先查临时表再查正式表
     auto conn = connection_pool<dbng<mysql>>::instance().get();
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "common.hpp"
+#include "entity.hpp"
+#include "periodic_task.hpp"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace purecpp {
+
+/**
+ * @brief 文章slug是否合法：8位字母或数字
+ */
+inline bool is_valid_slug(std::string_view slug) {
+  if (slug.size() != std::tuple_size_v<decltype(articles_t::slug)>) {
+    return false;
+  }
+  for (char c : slug) {
+    bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9');
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 文章浏览量的写回缓冲
+ *
+ * 浏览文章时只在内存中累加，按slug分片，已存在的计数直接原子加，
+ * 后台线程每隔一段时间把累计的增量合并成一条UPDATE写回数据库，
+ * 退出时再写回一次。pending返回尚未写回数据库的增量，
+ * 文章详情返回数据库中的浏览量加上这部分。
+ * 写回成功的增量会通知on_flush注册的回调，供热门文章等按批次累计浏览量。
+ */
+class view_counter {
+public:
+  using batch = std::vector<std::pair<std::string, uint32_t>>;
+  using listener = std::function<void(const batch &)>;
+
+  static view_counter &instance() {
+    static view_counter instance;
+    return instance;
+  }
+
+  /**
+   * @brief 启动后台写回线程
+   * @param interval_seconds 写回间隔（秒）
+   */
+  void start(int interval_seconds) {
+    if (interval_seconds <= 0) {
+      interval_seconds = 10;
+    }
+    task_.start(std::chrono::seconds(interval_seconds), [this] { flush(); });
+  }
+
+  /**
+   * @brief 停止后台线程并写回剩余的增量
+   */
+  void stop() {
+    task_.stop();
+    flush();
+  }
+
+  /**
+   * @brief 注册写回成功的回调，在写回的线程中调用，
+   * 每个增量只通知一次
+   */
+  void on_flush(listener fn) {
+    std::lock_guard lock(flush_mutex_);
+    listeners_.push_back(std::move(fn));
+  }
+
+  /**
+   * @brief 浏览量加1，调用方需保证slug合法
+   */
+  void increment(std::string_view slug) {
+    auto &shard = shard_of(slug);
+    {
+      std::shared_lock lock(shard.mutex);
+      auto it = shard.counters.find(slug);
+      if (it != shard.counters.end()) {
+        it->second->fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    std::unique_lock lock(shard.mutex);
+    auto [it, inserted] = shard.counters.try_emplace(
+        std::string(slug), std::make_unique<std::atomic<uint32_t>>(0));
+    it->second->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 尚未写回数据库的浏览量增量(包括正在写回的部分)
+   */
+  uint32_t pending(std::string_view slug) {
+    uint32_t count = 0;
+    auto &shard = shard_of(slug);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.counters.find(slug);
+    if (it != shard.counters.end()) {
+      count += it->second->load(std::memory_order_relaxed);
+    }
+    std::lock_guard flushing_lock(flushing_mutex_);
+    auto flushing_it = flushing_.find(slug);
+    if (flushing_it != flushing_.end()) {
+      count += flushing_it->second;
+    }
+    return count;
+  }
+
+  /**
+   * @brief 把累计的增量写回数据库，失败时放回缓冲区等待下次写回
+   */
+  void flush() {
+    std::lock_guard flush_lock(flush_mutex_);
+    batch items;
+    for (auto &shard : shards_) {
+      // 持有分片锁把增量移到flushing_，保证pending看到的总数不变
+      std::unique_lock lock(shard.mutex);
+      std::lock_guard flushing_lock(flushing_mutex_);
+      for (auto &[slug, counter] : shard.counters) {
+        if (uint32_t n = counter->load(std::memory_order_relaxed); n > 0) {
+          items.emplace_back(slug, n);
+          flushing_[slug] += n;
+        }
+      }
+      shard.counters.clear();
+    }
+    if (items.empty()) {
+      return;
+    }
+
+    size_t written = write_back(items);
+    if (written > 0 && !listeners_.empty()) {
+      batch done(items.begin(), items.begin() + written);
+      for (const auto &fn : listeners_) {
+        fn(done);
+      }
+    }
+    for (size_t i = 0; i < items.size(); i++) {
+      const auto &[slug, n] = items[i];
+      auto &shard = shard_of(slug);
+      std::unique_lock lock(shard.mutex);
+      std::lock_guard flushing_lock(flushing_mutex_);
+      flushing_.erase(slug);
+      // 没有写成功的放回缓冲区
+      if (i >= written) {
+        auto [it, inserted] = shard.counters.try_emplace(
+            slug, std::make_unique<std::atomic<uint32_t>>(0));
+        it->second->fetch_add(n, std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  view_counter() = default;
+  view_counter(const view_counter &) = delete;
+  view_counter &operator=(const view_counter &) = delete;
+
+  static constexpr size_t shard_count = 16;
+  static constexpr size_t max_batch_size = 500; // 每条UPDATE最多更新的文章数
+
+  struct string_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+
+  struct shard {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<std::atomic<uint32_t>>,
+                       string_hash, std::equal_to<>>
+        counters;
+  };
+
+  shard &shard_of(std::string_view slug) {
+    return shards_[string_hash{}(slug) % shard_count];
+  }
+
+  // UPDATE articles SET views_count = views_count + CASE slug WHEN ... END
+  // WHERE slug IN (...)，slug在计数前已校验只含字母和数字。
+  // 返回已写入的条数
+  static size_t write_back(const batch &items) {
+    auto conn = connection_pool<dbng<mysql>>::instance().get();
+    if (conn == nullptr) {
+      CINATRA_LOG_ERROR << "flush views failed: no db connection";
+      return 0;
+    }
+
+    for (size_t begin = 0; begin < items.size(); begin += max_batch_size) {
+      size_t end = std::min(items.size(), begin + max_batch_size);
+      std::string sql =
+          "UPDATE `articles` SET views_count = views_count + CASE slug";
+      std::string in_list;
+      for (size_t i = begin; i < end; i++) {
+        const auto &[slug, n] = items[i];
+        sql.append(" WHEN '").append(slug).append("' THEN ");
+        sql.append(std::to_string(n));
+        if (!in_list.empty()) {
+          in_list.append(",");
+        }
+        in_list.append("'").append(slug).append("'");
+      }
+      sql.append(" ELSE 0 END WHERE slug IN (").append(in_list).append(")");
+      if (!conn->execute(sql)) {
+        CINATRA_LOG_ERROR << "flush views failed: " << conn->get_last_error();
+        return begin;
+      }
+    }
+    return items.size();
+  }
+
+  std::array<shard, shard_count> shards_;
+  std::mutex flush_mutex_;    // 保证同一时间只有一个flush，保护listeners_
+  std::mutex flushing_mutex_; // 保护flushing_
+  std::unordered_map<std::string, uint32_t, string_hash, std::equal_to<>>
+      flushing_; // 正在写库的增量
+  std::vector<listener> listeners_;
+  periodic_task task_;
+};
+} // namespace purecpp